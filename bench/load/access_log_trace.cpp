@@ -0,0 +1,168 @@
+#include "access_log_trace.hpp"
+#include <algorithm>
+#include <charconv>
+
+namespace storm::load {
+
+namespace {
+
+// consume the characters of s up to the next space, or the quoted string that
+// starts s, unescaping it
+std::optional<std::string> next_token(std::string_view& s)
+{
+  s.remove_prefix(std::min(s.find_first_not_of(' '), s.size()));
+  if (s.empty()) {
+    return std::nullopt;
+  }
+
+  std::string result;
+  if (s.front() != '"') {
+    auto const end = std::min(s.find(' '), s.size());
+    result.assign(s.substr(0, end));
+    s.remove_prefix(end);
+    return result;
+  }
+
+  for (std::size_t i = 1; i != s.size(); ++i) {
+    if (s[i] == '\\' && i + 1 != s.size()) {
+      result.push_back(s[++i]);
+    } else if (s[i] == '"') {
+      s.remove_prefix(i + 1);
+      return result;
+    } else {
+      result.push_back(s[i]);
+    }
+  }
+  // unterminated
+  return std::nullopt;
+}
+
+template<class T>
+bool parse_number(std::string_view s, T& value)
+{
+  auto const [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && ptr == s.data() + s.size();
+}
+
+// e.g. 2024-01-31T15:04:05+01:00, as formatted by "{:%FT%T%Ez}"
+std::optional<std::time_t> parse_timestamp(std::string_view s)
+{
+  if (s.size() != 25 || s[10] != 'T' || (s[19] != '+' && s[19] != '-')) {
+    return std::nullopt;
+  }
+  std::tm tm{};
+  int offset_h{};
+  int offset_m{};
+  if (!parse_number(s.substr(0, 4), tm.tm_year)
+      || !parse_number(s.substr(5, 2), tm.tm_mon)
+      || !parse_number(s.substr(8, 2), tm.tm_mday)
+      || !parse_number(s.substr(11, 2), tm.tm_hour)
+      || !parse_number(s.substr(14, 2), tm.tm_min)
+      || !parse_number(s.substr(17, 2), tm.tm_sec)
+      || !parse_number(s.substr(20, 2), offset_h)
+      || !parse_number(s.substr(23, 2), offset_m)) {
+    return std::nullopt;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  auto const offset =
+      (offset_h * 3600 + offset_m * 60) * (s[19] == '+' ? 1 : -1);
+  return ::timegm(&tm) - offset;
+}
+
+// e.g. ["/a","/b",...]; the ellipsis marks a truncated list
+bool parse_paths(std::string_view s, std::vector<std::string>& paths)
+{
+  if (s.size() < 2 || s.front() != '[' || s.back() != ']') {
+    return false;
+  }
+  s = s.substr(1, s.size() - 2);
+  while (!s.empty()) {
+    if (s.starts_with("...")) {
+      return true;
+    }
+    auto path = next_token(s);
+    if (!path) {
+      return false;
+    }
+    paths.push_back(std::move(*path));
+    if (!s.empty()) {
+      if (s.front() != ',') {
+        return false;
+      }
+      s.remove_prefix(1);
+    }
+  }
+  return true;
+}
+
+bool has_stage_id(std::string_view operation)
+{
+  return operation == "STAGE" || operation == "STATUS" || operation == "CANCEL"
+      || operation == "RELEASE" || operation == "DELETE";
+}
+
+} // namespace
+
+std::optional<TraceEntry> parse_access_log_line(std::string_view line)
+{
+  TraceEntry entry;
+
+  auto const timestamp = next_token(line);
+  if (!timestamp) {
+    return std::nullopt;
+  }
+  if (auto t = parse_timestamp(*timestamp)) {
+    entry.timestamp = *t;
+  } else {
+    return std::nullopt;
+  }
+
+  // request id and principal are not needed
+  if (!next_token(line) || !next_token(line)) {
+    return std::nullopt;
+  }
+
+  auto operation  = next_token(line);
+  auto const code = next_token(line);
+  if (int c{}; !operation || !code || !parse_number(*code, c)) {
+    return std::nullopt;
+  }
+  entry.operation = std::move(*operation);
+
+  if (has_stage_id(entry.operation)) {
+    auto stage_id = next_token(line);
+    if (!stage_id) {
+      return std::nullopt;
+    }
+    entry.stage_id = std::move(*stage_id);
+  }
+
+  if (entry.operation == "STAGE") {
+    line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+    if (!parse_paths(line, entry.paths)) {
+      return std::nullopt;
+    }
+  }
+
+  return entry;
+}
+
+std::vector<TraceEntry> read_access_log(std::istream& is)
+{
+  std::vector<TraceEntry> result;
+  for (std::string line; std::getline(is, line);) {
+    if (auto entry = parse_access_log_line(line)) {
+      result.push_back(std::move(*entry));
+    }
+  }
+  // the lines are written when the requests complete, hence they may be
+  // slightly out of order
+  std::stable_sort(result.begin(), result.end(),
+                   [](TraceEntry const& a, TraceEntry const& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+  return result;
+}
+
+} // namespace storm::load
@@ -0,0 +1,34 @@
+#ifndef STORM_LOAD_ACCESS_LOG_TRACE_HPP
+#define STORM_LOAD_ACCESS_LOG_TRACE_HPP
+
+#include <ctime>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace storm::load {
+
+// A request as recorded in the access log by AccessLogger, i.e.
+//   <timestamp> <request id> <principal> <operation> <code> [<id>] [<files>]
+// where the stage id is present only for the operations on a stage and the
+// files only for STAGE, possibly truncated.
+struct TraceEntry
+{
+  std::time_t timestamp{};
+  std::string operation;
+  std::string stage_id;
+  std::vector<std::string> paths;
+};
+
+// return std::nullopt if the line is not in the expected format
+std::optional<TraceEntry> parse_access_log_line(std::string_view line);
+
+// the valid lines of an access log, in order of time; the other lines, e.g.
+// those of the error log interleaved on the standard output, are skipped
+std::vector<TraceEntry> read_access_log(std::istream& is);
+
+} // namespace storm::load
+
+#endif // STORM_LOAD_ACCESS_LOG_TRACE_HPP
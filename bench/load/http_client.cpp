@@ -0,0 +1,215 @@
+#include "http_client.hpp"
+#include <boost/algorithm/string/predicate.hpp>
+#include <fmt/core.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace storm::load {
+
+namespace {
+
+// the value of a header in the block of headers, which ends with an empty
+// line; the names are case-insensitive
+std::string_view header_value(std::string_view headers, std::string_view name)
+{
+  for (std::size_t pos = headers.find("\r\n"); pos != std::string_view::npos;) {
+    auto const begin = pos + 2;
+    auto const end   = headers.find("\r\n", begin);
+    if (end == std::string_view::npos || end == begin) {
+      break;
+    }
+    auto const line  = headers.substr(begin, end - begin);
+    auto const colon = line.find(':');
+    if (colon != std::string_view::npos
+        && boost::algorithm::iequals(line.substr(0, colon), name)) {
+      auto value = line.substr(colon + 1);
+      value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+      return value;
+    }
+    pos = end;
+  }
+  return {};
+}
+
+} // namespace
+
+HttpClient::HttpClient(std::string host, std::string port)
+    : m_host{std::move(host)}
+    , m_port{std::move(port)}
+{}
+
+HttpClient::~HttpClient()
+{
+  disconnect();
+}
+
+void HttpClient::connect()
+{
+  addrinfo hints{};
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses{nullptr};
+  if (auto const rc =
+          ::getaddrinfo(m_host.c_str(), m_port.c_str(), &hints, &addresses);
+      rc != 0) {
+    throw std::runtime_error{fmt::format("cannot resolve {}:{}: {}", m_host,
+                                         m_port, ::gai_strerror(rc))};
+  }
+
+  int err{0};
+  for (auto a = addresses; a != nullptr; a = a->ai_next) {
+    m_fd = ::socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC,
+                    a->ai_protocol);
+    if (m_fd == -1) {
+      err = errno;
+      continue;
+    }
+    if (::connect(m_fd, a->ai_addr, a->ai_addrlen) == 0) {
+      break;
+    }
+    err = errno;
+    ::close(m_fd);
+    m_fd = -1;
+  }
+  ::freeaddrinfo(addresses);
+
+  if (m_fd == -1) {
+    throw std::system_error(err, std::generic_category(),
+                            fmt::format("cannot connect to {}:{}", m_host,
+                                        m_port));
+  }
+  // the requests are small and a response is awaited after each of them
+  int const one{1};
+  ::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  m_buffer.clear();
+}
+
+void HttpClient::disconnect() noexcept
+{
+  if (m_fd != -1) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+void HttpClient::send_all(std::string_view data)
+{
+  while (!data.empty()) {
+    auto const n = ::send(m_fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "cannot send the request");
+    }
+    data.remove_prefix(static_cast<std::size_t>(n));
+  }
+}
+
+bool HttpClient::receive_more()
+{
+  std::array<char, 64 * 1024> chunk;
+  for (;;) {
+    auto const n = ::recv(m_fd, chunk.data(), chunk.size(), 0);
+    if (n > 0) {
+      m_buffer.append(chunk.data(), static_cast<std::size_t>(n));
+      return true;
+    }
+    if (n == 0) {
+      return false;
+    }
+    if (errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(),
+                              "cannot receive the response");
+    }
+  }
+}
+
+HttpResponse HttpClient::receive()
+{
+  std::size_t headers_end;
+  while ((headers_end = m_buffer.find("\r\n\r\n")) == std::string::npos) {
+    if (!receive_more()) {
+      throw std::runtime_error{"connection closed by the server"};
+    }
+  }
+  // the empty line is kept, to mark the end of the last header
+  std::string_view const headers{m_buffer.data(), headers_end + 2};
+
+  HttpResponse result;
+  // e.g. "HTTP/1.1 200 OK"
+  auto const space = headers.find(' ');
+  if (space == std::string_view::npos
+      || std::from_chars(headers.data() + space + 1,
+                         headers.data() + headers.size(), result.status)
+                 .ec
+             != std::errc{}) {
+    throw std::runtime_error{"invalid status line in the response"};
+  }
+
+  std::size_t length{0};
+  if (auto const value = header_value(headers, "Content-Length");
+      !value.empty()) {
+    std::from_chars(value.data(), value.data() + value.size(), length);
+  }
+  bool const close =
+      boost::algorithm::iequals(header_value(headers, "Connection"), "close");
+
+  auto const body_begin = headers_end + 4;
+  while (m_buffer.size() < body_begin + length) {
+    if (!receive_more()) {
+      throw std::runtime_error{"connection closed by the server"};
+    }
+  }
+  result.body.assign(m_buffer, body_begin, length);
+  m_buffer.erase(0, body_begin + length);
+
+  if (close) {
+    disconnect();
+  }
+  return result;
+}
+
+HttpResponse HttpClient::send(std::string_view method, std::string_view target,
+                              std::string_view body,
+                              std::string_view content_type)
+{
+  auto request = fmt::format("{} {} HTTP/1.1\r\nHost: {}:{}\r\n", method,
+                             target, m_host, m_port);
+  if (!body.empty()) {
+    request += fmt::format("Content-Type: {}\r\n", content_type);
+  }
+  request += fmt::format("Content-Length: {}\r\n\r\n", body.size());
+  request += body;
+
+  bool const reused = m_fd != -1;
+  if (!reused) {
+    connect();
+  }
+  try {
+    send_all(request);
+    return receive();
+  } catch (std::exception const&) {
+    disconnect();
+    // the server may have closed an idle connection, in which case nothing
+    // has been received
+    if (!reused || !m_buffer.empty()) {
+      throw;
+    }
+  }
+  connect();
+  send_all(request);
+  return receive();
+}
+
+} // namespace storm::load
@@ -0,0 +1,50 @@
+#ifndef STORM_LOAD_HTTP_CLIENT_HPP
+#define STORM_LOAD_HTTP_CLIENT_HPP
+
+#include <string>
+#include <string_view>
+
+namespace storm::load {
+
+struct HttpResponse
+{
+  int status{0};
+  std::string body;
+};
+
+// A minimal blocking HTTP/1.1 client, which keeps its connection open across
+// requests. It supports only what is needed to drive storm-tape, in
+// particular the response bodies must be delimited by a Content-Length. A
+// client is not thread-safe; each thread needs its own.
+class HttpClient
+{
+  std::string m_host;
+  std::string m_port;
+  int m_fd{-1};
+  // bytes received and not yet consumed
+  std::string m_buffer;
+
+  void connect();
+  void disconnect() noexcept;
+  void send_all(std::string_view data);
+  // return false if the connection has been closed before any byte arrived
+  bool receive_more();
+  HttpResponse receive();
+
+ public:
+  HttpClient(std::string host, std::string port);
+  ~HttpClient();
+  HttpClient(HttpClient const&)            = delete;
+  HttpClient& operator=(HttpClient const&) = delete;
+
+  // Send a request and wait for the response. A request on a connection that
+  // the server has closed in the meantime is retried once on a new
+  // connection. Throw std::system_error or std::runtime_error on failure.
+  HttpResponse send(std::string_view method, std::string_view target,
+                    std::string_view body         = {},
+                    std::string_view content_type = "application/json");
+};
+
+} // namespace storm::load
+
+#endif // STORM_LOAD_HTTP_CLIENT_HPP
@@ -0,0 +1,620 @@
+#include "access_log_trace.hpp"
+#include "extended_attributes.hpp"
+#include "http_client.hpp"
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+#include <fmt/core.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+namespace storm::load {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+  std::string host;
+  std::string port;
+  std::string access_point;
+  std::size_t n_files{};
+  std::size_t files_per_request{};
+  unsigned wlcg_clients{};
+  unsigned gemss_clients{};
+  // relative weights of STAGE, STATUS, CANCEL and ARCHIVEINFO
+  std::vector<double> mix;
+  std::size_t take_over{};
+  std::chrono::milliseconds gemss_interval{};
+  std::chrono::milliseconds think_time{};
+  std::chrono::seconds duration{};
+  double speed{};
+  std::uint64_t seed{};
+};
+
+// the latencies of the requests for a route, in milliseconds
+struct RouteSamples
+{
+  std::vector<double> latencies;
+  std::size_t errors{0};
+};
+
+using Samples = std::map<std::string, RouteSamples, std::less<>>;
+
+// The state of a thread generating load: its connection, its random numbers
+// and the measures of its requests
+class Session
+{
+  HttpClient m_client;
+  Samples m_samples;
+  std::size_t m_skipped{0};
+
+ public:
+  std::mt19937_64 rng;
+
+  Session(Options const& options, std::uint64_t seed)
+      : m_client{options.host, options.port}
+      , rng{seed}
+  {}
+
+  // a failure to talk to the server counts as an error, with status 0
+  HttpResponse call(std::string_view route, std::string_view method,
+                    std::string_view target, std::string_view body = {},
+                    std::string_view content_type = "application/json")
+  {
+    auto const start = Clock::now();
+    HttpResponse response;
+    try {
+      response = m_client.send(method, target, body, content_type);
+    } catch (std::exception const& e) {
+      std::cerr << fmt::format("{} {} failed: {}\n", method, target, e.what());
+    }
+    std::chrono::duration<double, std::milli> const elapsed =
+        Clock::now() - start;
+
+    auto it = m_samples.find(route);
+    if (it == m_samples.end()) {
+      it = m_samples.emplace(route, RouteSamples{}).first;
+    }
+    it->second.latencies.push_back(elapsed.count());
+    if (response.status == 0 || response.status >= 400) {
+      ++it->second.errors;
+    }
+    return response;
+  }
+
+  // a request of a trace that cannot be replayed
+  void skip()
+  {
+    ++m_skipped;
+  }
+
+  Samples const& samples() const
+  {
+    return m_samples;
+  }
+  std::size_t skipped() const
+  {
+    return m_skipped;
+  }
+};
+
+// The names of the files, spread over directories of 1000 files each, relative
+// to the access point (for the requests) or to the root (to populate the
+// storage area)
+std::vector<std::string> make_file_names(std::size_t n)
+{
+  std::vector<std::string> result;
+  result.reserve(n);
+  for (std::size_t i = 0; i != n; ++i) {
+    result.push_back(
+        fmt::format("storm-tape-load/dir{}/file{}", i / 1'000, i));
+  }
+  return result;
+}
+
+// Create the files below the root of a storage area, typically on a tmpfs,
+// with the xattrs that storm-tape inspects. All the files are on tape; some
+// are also on disk, the others are stubs, some of which are being recalled.
+void populate(fs::path const& root, std::vector<std::string> const& names,
+              std::size_t file_size, double on_disk_ratio,
+              double in_progress_ratio, std::uint64_t seed)
+{
+  std::mt19937_64 rng{seed};
+  std::bernoulli_distribution on_disk{on_disk_ratio};
+  std::bernoulli_distribution in_progress{in_progress_ratio};
+  std::string const content(file_size, '\0');
+  XAttrName const migrated{"user.storm.migrated"};
+  XAttrName const tsm_rect{"user.TSMRecT"};
+
+  for (auto const& name : names) {
+    auto const path = root / name;
+    fs::create_directories(path.parent_path());
+    if (on_disk(rng)) {
+      std::ofstream{path, std::ios::binary | std::ios::trunc} << content;
+    } else {
+      // a sparse file, without data blocks, looks like a stub
+      std::ofstream{path, std::ios::trunc};
+      fs::resize_file(path, file_size);
+      if (in_progress(rng)) {
+        set_xattr(path, tsm_rect, XAttrValue{""});
+      }
+    }
+    set_xattr(path, migrated, XAttrValue{""});
+  }
+}
+
+std::string stage_body(std::span<std::string const> paths)
+{
+  boost::json::array files;
+  files.reserve(paths.size());
+  for (auto const& path : paths) {
+    files.push_back(boost::json::object{{"path", path}});
+  }
+  return boost::json::serialize(boost::json::object{{"files", files}});
+}
+
+std::string paths_body(std::span<std::string const> paths)
+{
+  return boost::json::serialize(boost::json::object{
+      {"paths", boost::json::array(paths.begin(), paths.end())}});
+}
+
+std::string stage_id(HttpResponse const& response)
+{
+  if (response.status != 201) {
+    return {};
+  }
+  try {
+    auto const body = boost::json::parse(response.body);
+    return std::string{body.as_object().at("requestId").as_string()};
+  } catch (std::exception const&) {
+    return {};
+  }
+}
+
+// a random sequence of consecutive files, as if they were a dataset
+std::span<std::string const> pick_files(std::vector<std::string> const& paths,
+                                        std::size_t n, std::mt19937_64& rng)
+{
+  n = std::min(n, paths.size());
+  std::uniform_int_distribution<std::size_t> first{0, paths.size() - n};
+  return std::span{paths}.subspan(first(rng), n);
+}
+
+struct Stage
+{
+  std::string id;
+  std::vector<std::string> paths;
+};
+
+void stage(Session& s, std::span<std::string const> paths,
+           std::deque<Stage>& stages)
+{
+  auto const response =
+      s.call("STAGE", "POST", "/api/v1/stage", stage_body(paths));
+  if (auto id = stage_id(response); !id.empty()) {
+    stages.push_back({std::move(id), {paths.begin(), paths.end()}});
+  }
+}
+
+void cancel(Session& s, Stage const& stage)
+{
+  s.call("CANCEL", "POST", fmt::format("/api/v1/stage/{}/cancel", stage.id),
+         paths_body(stage.paths));
+}
+
+// One GEMSS polling cycle: take over the files ready to be recalled and look
+// at those in progress
+void poll_recall_table(Session& s, std::size_t max_take_over)
+{
+  auto const ready =
+      s.call("READY", "GET", "/recalltable/cardinality/tasks/readyTakeOver");
+  std::size_t n_ready{0};
+  std::from_chars(ready.body.data(), ready.body.data() + ready.body.size(),
+                  n_ready);
+  if (n_ready != 0) {
+    s.call("TAKE_OVER", "PUT", "/recalltable/tasks",
+           fmt::format("first={}", std::min(n_ready, max_take_over)),
+           "application/x-www-form-urlencoded");
+  }
+  s.call("IN_PROGRESS", "GET", "/recalltable/in_progress");
+}
+
+// A WLCG client, submitting stage requests and then polling, cancelling and
+// querying files, in the proportions given by the mix
+void run_wlcg_client(Session& s, Options const& options,
+                     std::vector<std::string> const& paths,
+                     Clock::time_point deadline)
+{
+  enum Op : int
+  {
+    op_stage,
+    op_status,
+    op_cancel,
+    op_archive_info
+  };
+  std::discrete_distribution<int> pick_op{options.mix.begin(),
+                                          options.mix.end()};
+  // the most recent stage requests of this client
+  std::deque<Stage> stages;
+  auto constexpr max_stages = 100;
+
+  while (Clock::now() < deadline) {
+    auto op = pick_op(s.rng);
+    if (stages.empty() && (op == op_status || op == op_cancel)) {
+      op = op_stage;
+    }
+
+    switch (op) {
+    case op_stage:
+      stage(s, pick_files(paths, options.files_per_request, s.rng), stages);
+      if (stages.size() > max_stages) {
+        stages.pop_front();
+      }
+      break;
+    case op_status: {
+      std::uniform_int_distribution<std::size_t> pick{0, stages.size() - 1};
+      s.call("STATUS", "GET",
+             fmt::format("/api/v1/stage/{}", stages[pick(s.rng)].id));
+      break;
+    }
+    case op_cancel: {
+      std::uniform_int_distribution<std::size_t> pick{0, stages.size() - 1};
+      auto const it = stages.begin() + static_cast<long>(pick(s.rng));
+      cancel(s, *it);
+      stages.erase(it);
+      break;
+    }
+    case op_archive_info:
+      s.call("ARCHIVEINFO", "POST", "/api/v1/archiveinfo",
+             paths_body(pick_files(paths, options.files_per_request, s.rng)));
+      break;
+    }
+
+    std::this_thread::sleep_for(options.think_time);
+  }
+}
+
+void run_gemss_client(Session& s, Options const& options,
+                      Clock::time_point deadline)
+{
+  for (auto next = Clock::now(); next < deadline;
+       next += options.gemss_interval) {
+    std::this_thread::sleep_until(next);
+    poll_recall_table(s, options.take_over);
+  }
+}
+
+// Replay the entries of a trace, at the original pace scaled by the speed, or
+// as fast as possible if the speed is 0. The stages are identified by the ids
+// in the trace, which are mapped to the ids returned by the server.
+void replay(Session& s, Options const& options,
+            std::vector<TraceEntry const*> const& entries, std::time_t origin,
+            Clock::time_point start, std::vector<std::string> const& paths)
+{
+  std::unordered_map<std::string, Stage> stages;
+  std::deque<Stage> staged;
+
+  auto find_stage = [&](std::string const& id) -> Stage const* {
+    auto const it = stages.find(id);
+    return it == stages.end() ? nullptr : &it->second;
+  };
+
+  for (auto const* e : entries) {
+    if (options.speed > 0) {
+      std::chrono::duration<double> const offset{
+          static_cast<double>(e->timestamp - origin) / options.speed};
+      std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<Clock::duration>(offset));
+    }
+
+    auto const& op = e->operation;
+    if (op == "STAGE") {
+      // the list of files in the trace may have been truncated to nothing
+      std::span<std::string const> files = e->paths;
+      if (files.empty()) {
+        files = pick_files(paths, options.files_per_request, s.rng);
+      }
+      if (files.empty()) {
+        s.skip();
+        continue;
+      }
+      stage(s, files, staged);
+      if (!staged.empty()) {
+        stages.insert_or_assign(e->stage_id, std::move(staged.back()));
+        staged.clear();
+      }
+    } else if (op == "STATUS" || op == "CANCEL" || op == "DELETE"
+               || op == "RELEASE") {
+      auto const* stage = find_stage(e->stage_id);
+      if (stage == nullptr) {
+        s.skip();
+      } else if (op == "STATUS") {
+        s.call(op, "GET", fmt::format("/api/v1/stage/{}", stage->id));
+      } else if (op == "CANCEL") {
+        cancel(s, *stage);
+      } else if (op == "DELETE") {
+        s.call(op, "DELETE", fmt::format("/api/v1/stage/{}", stage->id));
+      } else {
+        s.call(op, "POST", fmt::format("/api/v1/release/{}", stage->id),
+               paths_body(stage->paths));
+      }
+    } else if (op == "ARCHIVEINFO") {
+      // the files are not in the trace
+      auto const files = pick_files(paths, options.files_per_request, s.rng);
+      if (files.empty()) {
+        s.skip();
+      } else {
+        s.call(op, "POST", "/api/v1/archiveinfo", paths_body(files));
+      }
+    } else if (op == "READY") {
+      s.call(op, "GET", "/recalltable/cardinality/tasks/readyTakeOver");
+    } else if (op == "TAKE_OVER") {
+      s.call(op, "PUT", "/recalltable/tasks",
+             fmt::format("first={}", options.take_over),
+             "application/x-www-form-urlencoded");
+    } else if (op == "IN_PROGRESS") {
+      s.call(op, "GET", "/recalltable/in_progress");
+    } else if (op == "METRICS") {
+      s.call(op, "GET", "/metrics");
+    } else {
+      s.skip();
+    }
+  }
+}
+
+// Distribute the entries of a trace among n sessions. The entries about the
+// same stage go to the same session, so that they are replayed in order.
+std::vector<std::vector<TraceEntry const*>>
+partition(std::vector<TraceEntry> const& trace, std::size_t n)
+{
+  std::vector<std::vector<TraceEntry const*>> result(n);
+  std::size_t next{0};
+  for (auto const& e : trace) {
+    auto const i = e.stage_id.empty() || e.stage_id == "-"
+                     ? next++ % n
+                     : std::hash<std::string>{}(e.stage_id) % n;
+    result[i].push_back(&e);
+  }
+  return result;
+}
+
+// nearest-rank percentile of sorted values
+double percentile(std::vector<double> const& sorted, double p)
+{
+  auto const rank = static_cast<std::size_t>(
+      std::ceil(p * static_cast<double>(sorted.size())));
+  return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+
+void report(std::vector<std::unique_ptr<Session>> const& sessions,
+            std::chrono::duration<double> elapsed)
+{
+  Samples all;
+  std::size_t skipped{0};
+  for (auto const& s : sessions) {
+    for (auto const& [route, samples] : s->samples()) {
+      auto& r = all[route];
+      r.latencies.insert(r.latencies.end(), samples.latencies.begin(),
+                         samples.latencies.end());
+      r.errors += samples.errors;
+    }
+    skipped += s->skipped();
+  }
+
+  fmt::print("{:<12} {:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9}\n", "route",
+             "requests", "errors", "req/s", "p50 ms", "p90 ms", "p99 ms",
+             "max ms");
+  for (auto& [route, r] : all) {
+    std::sort(r.latencies.begin(), r.latencies.end());
+    fmt::print("{:<12} {:>9} {:>7} {:>9.1f} {:>9.2f} {:>9.2f} {:>9.2f} "
+               "{:>9.2f}\n",
+               route, r.latencies.size(), r.errors,
+               static_cast<double>(r.latencies.size()) / elapsed.count(),
+               percentile(r.latencies, 0.50), percentile(r.latencies, 0.90),
+               percentile(r.latencies, 0.99), r.latencies.back());
+  }
+  fmt::print("elapsed {:.1f} s", elapsed.count());
+  if (skipped != 0) {
+    fmt::print(", {} entries of the trace skipped", skipped);
+  }
+  fmt::print("\n");
+}
+
+// e.g. "stage=10,status=60,cancel=5,archiveinfo=25"
+std::vector<double> parse_mix(std::string const& s)
+{
+  std::vector<std::string_view> const ops{"stage", "status", "cancel",
+                                          "archiveinfo"};
+  std::vector<double> result(ops.size());
+  std::string_view rest{s};
+  while (!rest.empty()) {
+    auto const item = rest.substr(0, rest.find(','));
+    rest.remove_prefix(std::min(item.size() + 1, rest.size()));
+    auto const eq = item.find('=');
+    auto const it = std::find(ops.begin(), ops.end(), item.substr(0, eq));
+    double weight{-1};
+    if (eq != std::string_view::npos) {
+      std::from_chars(item.data() + eq + 1, item.data() + item.size(), weight);
+    }
+    if (it == ops.end() || weight < 0) {
+      throw std::runtime_error{fmt::format("invalid mix entry '{}'", item)};
+    }
+    result[static_cast<std::size_t>(it - ops.begin())] = weight;
+  }
+  if (std::all_of(result.begin(), result.end(),
+                  [](double w) { return w == 0.; })) {
+    throw std::runtime_error{"the mix is empty"};
+  }
+  return result;
+}
+
+} // namespace
+
+} // namespace storm::load
+
+int main(int argc, char* argv[])
+{
+  using namespace storm::load;
+
+  try {
+    Options options;
+    std::string mix;
+    std::string populate_root;
+    std::string trace_file;
+    std::size_t file_size{};
+    double on_disk_ratio{};
+    double in_progress_ratio{};
+    long long gemss_interval{};
+    long long think_time{};
+    long long duration{};
+
+    po::options_description desc("Allowed options");
+
+    // clang-format off
+    desc.add_options()
+    ("help,h", "produce help message")
+    ("host", po::value(&options.host)->default_value("localhost"),
+     "host of the server")
+    ("port", po::value(&options.port)->default_value("8080"),
+     "port of the server")
+    ("access-point", po::value(&options.access_point)->default_value("/tmp"),
+     "access point of the storage area, to build the logical paths")
+    ("files", po::value(&options.n_files)->default_value(10'000),
+     "number of files in the storage area")
+    ("files-per-request",
+     po::value(&options.files_per_request)->default_value(100),
+     "number of files in each request")
+    ("wlcg-clients", po::value(&options.wlcg_clients)->default_value(8),
+     "number of concurrent WLCG clients, or of threads replaying a trace")
+    ("gemss-clients", po::value(&options.gemss_clients)->default_value(1),
+     "number of concurrent GEMSS clients")
+    ("mix",
+     po::value(&mix)->default_value(
+         "stage=10,status=60,cancel=5,archiveinfo=25"),
+     "relative weights of the requests of the WLCG clients")
+    ("take-over", po::value(&options.take_over)->default_value(1'000),
+     "maximum number of files taken over by GEMSS at once")
+    ("gemss-interval", po::value(&gemss_interval)->default_value(1'000),
+     "milliseconds between two polls of GEMSS")
+    ("think-time", po::value(&think_time)->default_value(0),
+     "milliseconds between two requests of a WLCG client")
+    ("duration", po::value(&duration)->default_value(60),
+     "seconds of load; 0 to only populate the storage area")
+    ("populate", po::value(&populate_root),
+     "create the files below this root of the storage area before the load, "
+     "e.g. on a tmpfs")
+    ("file-size", po::value(&file_size)->default_value(4'096),
+     "size of the files created by --populate")
+    ("on-disk-ratio", po::value(&on_disk_ratio)->default_value(0.2),
+     "fraction of the files created on disk, the others are stubs")
+    ("in-progress-ratio", po::value(&in_progress_ratio)->default_value(0.1),
+     "fraction of the stubs created with a recall in progress")
+    ("replay", po::value(&trace_file),
+     "replay the requests in this access log instead of generating them")
+    ("speed", po::value(&options.speed)->default_value(1.),
+     "speed of the replay relative to the trace; 0 is as fast as possible")
+    ("seed", po::value(&options.seed)->default_value(42),
+     "seed of the random numbers");
+    // clang-format on
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return EXIT_SUCCESS;
+    }
+
+    options.mix            = parse_mix(mix);
+    options.gemss_interval = std::chrono::milliseconds{gemss_interval};
+    options.think_time     = std::chrono::milliseconds{think_time};
+    options.duration       = std::chrono::seconds{duration};
+
+    auto const names = make_file_names(options.n_files);
+    if (!populate_root.empty()) {
+      populate(populate_root, names, file_size, on_disk_ratio,
+               in_progress_ratio, options.seed);
+      fmt::print("Created {} files below {}\n", names.size(), populate_root);
+    }
+    if (options.duration.count() == 0 && trace_file.empty()) {
+      return EXIT_SUCCESS;
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(names.size());
+    for (auto const& name : names) {
+      paths.push_back((fs::path{options.access_point} / name).string());
+    }
+
+    std::vector<TraceEntry> trace;
+    if (!trace_file.empty()) {
+      std::ifstream is{trace_file};
+      if (!is) {
+        throw std::runtime_error{"cannot open " + trace_file};
+      }
+      trace = read_access_log(is);
+      fmt::print("Replaying {} requests from {}\n", trace.size(), trace_file);
+    }
+
+    std::vector<std::unique_ptr<Session>> sessions;
+    auto const n_sessions = trace_file.empty()
+                              ? options.wlcg_clients + options.gemss_clients
+                              : std::max(options.wlcg_clients, 1U);
+    for (unsigned i = 0; i != n_sessions; ++i) {
+      sessions.push_back(std::make_unique<Session>(options, options.seed + i));
+    }
+
+    auto const parts    = partition(trace, n_sessions);
+    auto const start    = Clock::now();
+    auto const deadline = start + options.duration;
+    {
+      std::vector<std::jthread> threads;
+      if (trace_file.empty()) {
+        for (unsigned i = 0; i != options.wlcg_clients; ++i) {
+          threads.emplace_back([&, &s = *sessions[i]] {
+            run_wlcg_client(s, options, paths, deadline);
+          });
+        }
+        for (auto i = options.wlcg_clients; i != n_sessions; ++i) {
+          threads.emplace_back([&, &s = *sessions[i]] {
+            run_gemss_client(s, options, deadline);
+          });
+        }
+      } else if (!trace.empty()) {
+        for (unsigned i = 0; i != n_sessions; ++i) {
+          threads.emplace_back([&, &s = *sessions[i], &part = parts[i]] {
+            replay(s, options, part, trace.front().timestamp, start, paths);
+          });
+        }
+      }
+    }
+
+    report(sessions, Clock::now() - start);
+  } catch (std::exception const& e) {
+    std::cerr << fmt::format("Caught exception: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+}
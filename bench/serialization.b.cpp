@@ -0,0 +1,203 @@
+#include <benchmark/benchmark.h>
+#include <crow/http_response.h>
+#include <fmt/core.h>
+#include <ctime>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "archiveinfo_response.hpp"
+#include "configuration.hpp"
+#include "file.hpp"
+#include "in_progress_response.hpp"
+#include "io.hpp"
+#include "requests_with_paths.hpp"
+#include "stage_request.hpp"
+#include "stage_response.hpp"
+#include "status_response.hpp"
+#include "storage_area_resolver.hpp"
+
+namespace storm {
+
+namespace {
+
+auto constexpr N_VOS = 10;
+
+// storage areas with nested access points, so that the longest prefix is not
+// the first match; the roots must exist
+Configuration make_configuration()
+{
+  std::string yaml{"storage-areas:\n"};
+  for (int i = 0; i != N_VOS; ++i) {
+    fmt::format_to(std::back_inserter(yaml),
+                   "- name: disk{0}\n"
+                   "  root: /tmp\n"
+                   "  access-point: /vo{0}\n"
+                   "- name: tape{0}\n"
+                   "  root: /tmp\n"
+                   "  access-point: /vo{0}/data/tape\n",
+                   i);
+  }
+  std::istringstream is{yaml};
+  return load_configuration(is);
+}
+
+LogicalPaths make_paths(std::size_t n)
+{
+  LogicalPaths paths;
+  paths.reserve(n);
+  for (std::size_t i = 0; i != n; ++i) {
+    paths.push_back(LogicalPath{
+        fmt::format("/vo{}/data/tape/dir{}/file{}", i % N_VOS,
+                    i / 1'000, i)});
+  }
+  return paths;
+}
+
+Files make_files(std::size_t n)
+{
+  auto const now = std::time(nullptr);
+  Files files;
+  files.reserve(n);
+  for (auto& path : make_paths(n)) {
+    auto physical = PhysicalPath{"/tmp" / path.relative_path()};
+    files.push_back(File{.logical_path  = std::move(path),
+                         .physical_path = std::move(physical),
+                         .state         = File::State::started,
+                         .locality      = Locality::tape,
+                         .started_at    = now});
+  }
+  return files;
+}
+
+void set_counters(benchmark::State& state)
+{
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void storage_area_resolver(benchmark::State& state)
+{
+  auto const config = make_configuration();
+  StorageAreaResolver const resolve{config.storage_areas};
+  auto const paths = make_paths(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    for (auto const& path : paths) {
+      benchmark::DoNotOptimize(resolve(path));
+    }
+  }
+  set_counters(state);
+}
+
+void storage_area_resolver_batch(benchmark::State& state)
+{
+  auto const config = make_configuration();
+  StorageAreaResolver const resolve{config.storage_areas};
+  auto const paths = make_paths(static_cast<std::size_t>(state.range(0)));
+  PhysicalPaths out(paths.size());
+  for (auto _ : state) {
+    resolve(paths, out);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state);
+}
+
+void from_json_stage_request(benchmark::State& state)
+{
+  std::string body{R"({"files":[)"};
+  auto const n = static_cast<std::size_t>(state.range(0));
+  for (auto const& path : make_paths(n)) {
+    fmt::format_to(std::back_inserter(body), R"({{"path":"{}"}},)",
+                   path.string());
+  }
+  body.back() = ']';
+  body.push_back('}');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(from_json(body, StageRequest::tag));
+  }
+  state.SetBytesProcessed(state.iterations()
+                          * static_cast<std::int64_t>(body.size()));
+  set_counters(state);
+}
+
+void from_json_paths(benchmark::State& state)
+{
+  std::string body{R"({"paths":[)"};
+  auto const n = static_cast<std::size_t>(state.range(0));
+  for (auto const& path : make_paths(n)) {
+    fmt::format_to(std::back_inserter(body), R"("{}",)", path.string());
+  }
+  body.back() = ']';
+  body.push_back('}');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(from_json(body, RequestWithPaths::tag));
+  }
+  state.SetBytesProcessed(state.iterations()
+                          * static_cast<std::int64_t>(body.size()));
+  set_counters(state);
+}
+
+void to_crow_response_stage(benchmark::State& state)
+{
+  StageResponse const resp{
+      "bench", make_files(static_cast<std::size_t>(state.range(0)))};
+  HostInfo const info{.proto = "https", .host = "localhost", .port = "8443"};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(to_crow_response(resp, info));
+  }
+  set_counters(state);
+}
+
+void to_crow_response_status(benchmark::State& state)
+{
+  auto const now = std::time(nullptr);
+  StatusResponse const resp{
+      "bench",
+      StageRequest{make_files(static_cast<std::size_t>(state.range(0))), now,
+                   now, 0}};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(to_crow_response(resp));
+  }
+  set_counters(state);
+}
+
+void to_crow_response_archive_info(benchmark::State& state)
+{
+  ArchiveInfoResponse resp;
+  for (auto& path : make_paths(static_cast<std::size_t>(state.range(0)))) {
+    resp.infos.push_back(PathInfo{std::move(path), Locality::tape});
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(to_crow_response(resp));
+  }
+  set_counters(state);
+}
+
+void to_crow_response_in_progress(benchmark::State& state)
+{
+  InProgressResponse resp;
+  for (auto& file : make_files(static_cast<std::size_t>(state.range(0)))) {
+    resp.paths.push_back(std::move(file.physical_path));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(to_crow_response(resp));
+  }
+  set_counters(state);
+}
+
+void n_files(benchmark::internal::Benchmark* b)
+{
+  b->ArgName("files")->Arg(1)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+}
+
+} // namespace
+
+BENCHMARK(storage_area_resolver)->Apply(n_files);
+BENCHMARK(storage_area_resolver_batch)->Apply(n_files);
+BENCHMARK(from_json_stage_request)->Apply(n_files);
+BENCHMARK(from_json_paths)->Apply(n_files);
+BENCHMARK(to_crow_response_stage)->Apply(n_files);
+BENCHMARK(to_crow_response_status)->Apply(n_files);
+BENCHMARK(to_crow_response_archive_info)->Apply(n_files);
+BENCHMARK(to_crow_response_in_progress)->Apply(n_files);
+
+} // namespace storm
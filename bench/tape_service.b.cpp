@@ -0,0 +1,229 @@
+#include <benchmark/benchmark.h>
+#include <soci/soci.h>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+
+#include "archiveinfo_response.hpp"
+#include "configuration.hpp"
+#include "database_soci.hpp"
+#include "file.hpp"
+#include "in_progress_response.hpp"
+#include "requests_with_paths.hpp"
+#include "stage_request.hpp"
+#include "stage_response.hpp"
+#include "status_response.hpp"
+#include "storage.hpp"
+#include "takeover_request.hpp"
+#include "takeover_response.hpp"
+#include "tape_service.hpp"
+
+namespace storm {
+
+namespace {
+
+auto constexpr DB_NAME = "storm-tape-bench.sqlite";
+
+auto constexpr CONFIG = R"(
+storage-areas:
+- name: bench
+  root: /tmp
+  access-point: /bench
+)";
+
+// All the files are regular files on tape, not yet recalled, so that the
+// service does the most work for each of them. The storage is never touched,
+// hence the measures do not depend on the filesystem, except for stage(),
+// which checks that the files exist and fails them all.
+struct SyntheticStorage : Storage
+{
+  Result<bool> is_in_progress(PhysicalPath const&) override
+  {
+    return false;
+  }
+  Result<FileSizeInfo> file_size_info(PhysicalPath const&) override
+  {
+    return FileSizeInfo{.size = 1024 * 1024, .is_stub = true};
+  }
+  Result<bool> is_on_tape(PhysicalPath const&) override
+  {
+    return true;
+  }
+  FileStatuses file_statuses(std::span<PhysicalPath const> paths) override
+  {
+    FileStatuses result(paths.size());
+    for (std::size_t i = 0; i != paths.size(); ++i) {
+      result.types[i]   = fs::file_type::regular;
+      result.sizes[i]   = 1024 * 1024;
+      result.is_stub[i] = true;
+      result.on_tape[i] = true;
+    }
+    return result;
+  }
+  Result<void> set_in_progress(PhysicalPath const&) override
+  {
+    return {};
+  }
+};
+
+enum class Backend : int
+{
+  memory,
+  disk
+};
+
+// the files are spread over directories of 1000 files each
+Files make_files(std::size_t n, File::State state)
+{
+  Files files;
+  files.reserve(n);
+  for (std::size_t i = 0; i != n; ++i) {
+    auto const tail = fs::path{"dir" + std::to_string(i / 1'000)}
+                    / ("file" + std::to_string(i));
+    files.push_back(File{.logical_path  = LogicalPath{"/bench" / tail},
+                         .physical_path = PhysicalPath{"/tmp" / tail},
+                         .state         = state});
+  }
+  return files;
+}
+
+class Service
+{
+  Backend m_backend;
+  Configuration m_config;
+  std::unique_ptr<soci::connection_pool> m_pool;
+  SyntheticStorage m_storage;
+  int m_n_stages{0};
+
+ public:
+  SociDatabase db;
+  TapeService service;
+
+  explicit Service(benchmark::State const& state)
+      : m_backend{static_cast<Backend>(state.range(1))}
+      , m_config{[] {
+        std::istringstream is{CONFIG};
+        return load_configuration(is);
+      }()}
+      , m_pool{make_sqlite_pool(
+            1, {.path = m_backend == Backend::disk ? DB_NAME : ":memory:"})}
+      , db{*m_pool}
+      , service{m_config, db, m_storage}
+  {}
+  ~Service()
+  {
+    if (m_backend == Backend::disk) {
+      fs::remove(DB_NAME);
+      fs::remove(std::string{DB_NAME} + "-wal");
+      fs::remove(std::string{DB_NAME} + "-shm");
+    }
+  }
+  Service(Service const&)            = delete;
+  Service& operator=(Service const&) = delete;
+
+  // insert a stage with n files in the given state, bypassing stage()
+  StageId insert(std::size_t n, File::State state)
+  {
+    auto const now = std::time(nullptr);
+    StageId id{"bench-" + std::to_string(++m_n_stages)};
+    db.insert(id, StageRequest{make_files(n, state), now, now, 0});
+    return id;
+  }
+};
+
+void set_counters(benchmark::State& state)
+{
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void tape_service_stage(benchmark::State& state)
+{
+  Service s{state};
+  auto const n = static_cast<std::size_t>(state.range(0));
+  StageRequest const request{make_files(n, File::State::submitted),
+                             std::time(nullptr), 0, 0};
+  for (auto _ : state) {
+    auto resp = s.service.stage(request);
+    state.PauseTiming();
+    // keep the size of the database constant
+    s.db.erase(resp.id());
+    state.ResumeTiming();
+  }
+  set_counters(state);
+}
+
+void tape_service_status(benchmark::State& state)
+{
+  Service s{state};
+  auto const n  = static_cast<std::size_t>(state.range(0));
+  auto const id = s.insert(n, File::State::started);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(s.service.status(id));
+  }
+  set_counters(state);
+}
+
+void tape_service_archive_info(benchmark::State& state)
+{
+  Service s{state};
+  auto const n = static_cast<std::size_t>(state.range(0));
+  ArchiveInfoRequest request;
+  for (auto& file : make_files(n, File::State::submitted)) {
+    request.paths.push_back(std::move(file.logical_path));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(s.service.archive_info(request));
+  }
+  set_counters(state);
+}
+
+void tape_service_take_over(benchmark::State& state)
+{
+  Service s{state};
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto id = s.insert(n, File::State::submitted);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(s.service.take_over({.n_files = n}));
+    state.PauseTiming();
+    // the files cannot go back to submitted, hence a new stage is needed for
+    // the next take over
+    s.db.erase(id);
+    id = s.insert(n, File::State::submitted);
+    state.ResumeTiming();
+  }
+  set_counters(state);
+}
+
+void tape_service_in_progress(benchmark::State& state)
+{
+  Service s{state};
+  auto const n = static_cast<std::size_t>(state.range(0));
+  s.insert(n, File::State::started);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(s.service.in_progress());
+  }
+  set_counters(state);
+}
+
+// number of files, and whether the database is in memory or on disk
+void files_and_backend(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"files", "disk"})
+      ->ArgsProduct({{1, 1'000, 10'000, 100'000},
+                     {static_cast<int>(Backend::memory),
+                      static_cast<int>(Backend::disk)}})
+      ->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(tape_service_stage)->Apply(files_and_backend);
+BENCHMARK(tape_service_status)->Apply(files_and_backend);
+BENCHMARK(tape_service_archive_info)->Apply(files_and_backend);
+BENCHMARK(tape_service_take_over)->Apply(files_and_backend);
+BENCHMARK(tape_service_in_progress)->Apply(files_and_backend);
+
+} // namespace storm
@@ -0,0 +1,140 @@
+#include "access_log_writer.hpp"
+#include <crow/logging.h>
+#include <fmt/core.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+namespace storm {
+
+namespace {
+
+bool is_stdout(Path const& path)
+{
+  return path == "-";
+}
+
+std::FILE* open_log(Path const& path)
+{
+  if (is_stdout(path)) {
+    return stdout;
+  }
+  auto const file = std::fopen(path.c_str(), "a");
+  if (file == nullptr) {
+    throw std::system_error(errno, std::generic_category(),
+                            "cannot open access log " + path.string());
+  }
+  return file;
+}
+
+} // namespace
+
+AccessLogWriter::AccessLogWriter(Path path, std::size_t capacity)
+    : m_path{std::move(path)}
+    , m_capacity{capacity}
+    , m_file{open_log(m_path)}
+{
+  m_thread = std::jthread{[this] { run(); }};
+}
+
+AccessLogWriter::~AccessLogWriter()
+{
+  {
+    std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  // the pending lines are written before the thread exits
+  m_thread.join();
+  if (m_file != stdout) {
+    std::fclose(m_file);
+  }
+}
+
+bool AccessLogWriter::push(std::string_view line)
+{
+  bool was_empty;
+  {
+    std::lock_guard lock{m_mutex};
+    if (m_pending.size() + line.size() + 1 > m_capacity) {
+      ++m_dropped;
+      return false;
+    }
+    was_empty = m_pending.empty();
+    m_pending.append(line);
+    m_pending.push_back('\n');
+  }
+  // otherwise the writer has already been woken up
+  if (was_empty) {
+    m_cv.notify_one();
+  }
+  return true;
+}
+
+void AccessLogWriter::run()
+{
+  using namespace std::chrono_literals;
+  // swapped with the pending buffer, so that both keep their capacity
+  std::string batch;
+
+  for (;;) {
+    std::uint64_t dropped;
+    bool stop;
+    {
+      std::unique_lock lock{m_mutex};
+      // wake up periodically anyway, to honor the requests to reopen
+      m_cv.wait_for(lock, 1s,
+                    [this] { return m_stop || !m_pending.empty(); });
+      batch.clear();
+      std::swap(batch, m_pending);
+      dropped = std::exchange(m_dropped, 0);
+      stop    = m_stop;
+    }
+
+    if (s_reopen.exchange(false, std::memory_order_relaxed)) {
+      reopen();
+    }
+    if (dropped != 0) {
+      CROW_LOG_WARNING << fmt::format(
+          "Dropped {} lines of the access log, the writer cannot keep up",
+          dropped);
+    }
+    write(batch);
+
+    if (stop) {
+      return;
+    }
+  }
+}
+
+void AccessLogWriter::reopen()
+{
+  if (is_stdout(m_path)) {
+    return;
+  }
+  try {
+    auto const file = open_log(m_path);
+    std::fclose(m_file);
+    m_file = file;
+  } catch (std::exception const& e) {
+    // keep writing to the old file
+    CROW_LOG_ERROR << e.what();
+  }
+}
+
+void AccessLogWriter::write(std::string_view lines)
+{
+  if (lines.empty()) {
+    return;
+  }
+  if (std::fwrite(lines.data(), 1, lines.size(), m_file) != lines.size()
+      || std::fflush(m_file) != 0) {
+    CROW_LOG_ERROR << fmt::format("Cannot write the access log: {}",
+                                  std::strerror(errno));
+    std::clearerr(m_file);
+  }
+}
+
+} // namespace storm
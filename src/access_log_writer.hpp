@@ -0,0 +1,63 @@
+#ifndef STORM_ACCESS_LOG_WRITER_HPP
+#define STORM_ACCESS_LOG_WRITER_HPP
+
+#include "types.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace storm {
+
+// Write the lines of the access log from a background thread.
+//
+// The lines are appended to a pending buffer, which the writer swaps with its
+// own and writes out in one go, so that the threads serving the requests never
+// wait for the output. The pending buffer is bounded: a line that does not fit
+// is dropped, and the number of dropped lines is reported in the error log.
+// The file is reopened on request, e.g. on SIGHUP after a logrotate.
+class AccessLogWriter
+{
+  static inline std::atomic<bool> s_reopen{false};
+
+  Path m_path;
+  std::size_t m_capacity;
+  std::FILE* m_file{nullptr};
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::string m_pending;
+  std::uint64_t m_dropped{0};
+  bool m_stop{false};
+  std::jthread m_thread;
+
+  void run();
+  void reopen();
+  void write(std::string_view lines);
+
+ public:
+  // "-" is the standard output; throw std::system_error if the file cannot be
+  // opened
+  AccessLogWriter(Path path, std::size_t capacity);
+  ~AccessLogWriter();
+  AccessLogWriter(AccessLogWriter const&)            = delete;
+  AccessLogWriter& operator=(AccessLogWriter const&) = delete;
+
+  // Queue a line, given without the trailing newline. Return false if the line
+  // has been dropped because the pending buffer is full.
+  bool push(std::string_view line);
+
+  // lock-free, hence safe to call from a signal handler
+  static void request_reopen() noexcept
+  {
+    s_reopen.store(true, std::memory_order_relaxed);
+  }
+};
+
+} // namespace storm
+
+#endif // STORM_ACCESS_LOG_WRITER_HPP
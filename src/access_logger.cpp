@@ -1,10 +1,12 @@
 #include "access_logger.hpp"
+#include "access_log_writer.hpp"
 #include <fmt/chrono.h>
 #include <fmt/core.h>
-#include <chrono>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iterator>
+#include <string_view>
 
 namespace {
 bool acceptable_request_id(std::string_view id)
@@ -15,70 +17,101 @@ bool acceptable_request_id(std::string_view id)
   return id.size() > 0U && id.size() <= 32U
       && id.find_first_not_of(acceptable) == std::string::npos;
 }
-} // namespace
 
-void storm::AccessLogger::after_handle(crow::request& req, crow::response& res,
-                                       context& ctx)
+// same output as std::quoted, without the stream
+void append_quoted(std::string& out, std::string_view s)
 {
-  auto const timestamp = [] {
-    return fmt::format("{:%FT%T%Ez}", fmt::localtime(std::time({})));
-  }();
-  auto const request_id = [&] {
-    auto& id = req.get_header_value("x-request-id");
-    return acceptable_request_id(id) ? id : "-";
-  }();
-  auto const principal = [&] {
-    if (auto sub = req.get_header_value("x-sub"); !sub.empty()) {
-      return sub;
-    } else if (auto voms_user = req.get_header_value("x-voms_user");
-               !voms_user.empty()) {
-      std::ostringstream os;
-      os << std::quoted(voms_user);
-      return os.str();
-    } else {
-      return std::string{"-"};
+  out.push_back('"');
+  for (auto c : s) {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
     }
-  }();
-  auto files = [&](long space_left) {
-    space_left -= 6; // for the square brackets, a comma and the ellipsis
+    out.push_back(c);
+  }
+  out.push_back('"');
+}
+
+long quoted_size(std::string_view s)
+{
+  return std::ssize(s) + 2 + std::ranges::count(s, '"')
+       + std::ranges::count(s, '\\');
+}
+
+// the timestamp has a resolution of one second, so it is formatted at most
+// once per second per thread
+std::string_view timestamp()
+{
+  thread_local std::time_t last{-1};
+  thread_local std::string formatted;
+  if (auto const now = std::time({}); now != last) {
+    formatted = fmt::format("{:%FT%T%Ez}", fmt::localtime(now));
+    last      = now;
+  }
+  return formatted;
+}
 
-    std::ostringstream result;
-    result << '[';
+void append_files(std::string& out, storm::Files const& files, long space_left)
+{
+  space_left -= 6; // for the square brackets, a comma and the ellipsis
 
-    bool first = true;
-    for (auto& file : ctx.files) {
-      std::ostringstream os;
-      os << std::quoted(file.logical_path.string());
-      std::string qs{os.str()};
-      if (std::ssize(qs) + (first ? 0 : 1) > space_left) { // consider the comma
-        qs = "...";
-      }
-      if (first) {
-        result << qs;
-        first = false;
-      } else {
-        result << ',' << qs;
-      }
-      space_left -= std::ssize(qs);
-      if (qs == "...") {
-        break;
-      }
+  out.push_back('[');
+  bool first = true;
+  for (auto& file : files) {
+    auto const& path = file.logical_path.native();
+    auto const size  = quoted_size(path);
+    if (size + (first ? 0 : 1) > space_left) { // consider the comma
+      out.append(first ? "..." : ",...");
+      break;
+    }
+    if (!first) {
+      out.push_back(',');
     }
-    result << ']';
-    return result.str();
-  };
+    append_quoted(out, path);
+    space_left -= size;
+    first = false;
+  }
+  out.push_back(']');
+}
+} // namespace
+
+void storm::AccessLogger::after_handle(crow::request& req, crow::response& res,
+                                       context& ctx)
+{
+  // reused across the requests served by the same thread
+  thread_local std::string line;
+  line.clear();
 
-  std::ostringstream os;
-  os << timestamp << ' ' << request_id << ' ' << principal << ' '
-     << ctx.operation << ' ' << res.code;
+  line.append(timestamp());
+  line.push_back(' ');
+  auto& id = req.get_header_value("x-request-id");
+  line.append(acceptable_request_id(id) ? std::string_view{id} : "-");
+  line.push_back(' ');
+  if (auto& sub = req.get_header_value("x-sub"); !sub.empty()) {
+    line.append(sub);
+  } else if (auto& voms_user = req.get_header_value("x-voms_user");
+             !voms_user.empty()) {
+    append_quoted(line, voms_user);
+  } else {
+    line.push_back('-');
+  }
+  fmt::format_to(std::back_inserter(line), " {} {}", ctx.operation, res.code);
   if (ctx.operation == "STAGE" || ctx.operation == "STATUS"
       || ctx.operation == "CANCEL" || ctx.operation == "RELEASE"
       || ctx.operation == "DELETE") {
-    os << ' ' << ctx.stage_id;
+    line.push_back(' ');
+    line.append(ctx.stage_id);
   }
   if (ctx.operation == "STAGE") {
     constexpr long max_line_length = 2'048;
-    os << ' ' << files(max_line_length - static_cast<long>(os.tellp()));
+    auto const space_left          = max_line_length - std::ssize(line);
+    line.push_back(' ');
+    append_files(line, ctx.files, space_left);
+  }
+
+  if (writer != nullptr) {
+    writer->push(line);
+  } else {
+    line.push_back('\n');
+    std::fwrite(line.data(), 1, line.size(), stdout);
   }
-  std::cout << os.str() << '\n';
 }
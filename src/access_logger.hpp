@@ -7,6 +7,8 @@
 
 namespace storm {
 
+class AccessLogWriter;
+
 struct AccessLogger
 {
   struct context
@@ -16,6 +18,9 @@ struct AccessLogger
     Files files;
   };
 
+  // if not set, the lines are written synchronously to the standard output
+  AccessLogWriter* writer{nullptr};
+
   void before_handle(crow::request&, crow::response&, context&)
   {}
 
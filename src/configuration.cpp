@@ -1,6 +1,7 @@
 #include "configuration.hpp"
 #include "extended_attributes.hpp"
 
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/lexical_cast/try_lexical_convert.hpp>
 #include <boost/uuid/random_generator.hpp>
@@ -10,12 +11,16 @@
 #include <yaml-cpp/yaml.h>
 
 #include <algorithm>
+#include <climits>
 #include <fstream>
+#include <initializer_list>
+#include <limits>
 #include <numeric>
 #include <optional>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 
 namespace algo = boost::algorithm;
 
@@ -324,6 +329,251 @@ static std::optional<bool> load_mirror_mode(YAML::Node const& node)
   throw std::runtime_error{"invalid 'mirror-mode' entry in configuration"};
 }
 
+template<typename T>
+static std::optional<T> load_integer(YAML::Node const& node,
+                                     std::string_view key, T min, T max)
+{
+  if (!node.IsDefined()) {
+    return {};
+  }
+
+  if (node.IsNull()) {
+    throw std::runtime_error{fmt::format("{} is null", key)};
+  }
+
+  // the conversion to an unsigned type accepts a negative number and wraps it
+  auto const negative = std::is_unsigned_v<T> && node.IsScalar()
+                     && node.Scalar().starts_with('-');
+
+  T value;
+  if (!negative && boost::conversion::try_lexical_convert(node, value)) {
+    if (value >= min && value <= max) {
+      return value;
+    }
+  }
+  throw std::runtime_error{
+      fmt::format("invalid '{}' entry in configuration", key)};
+}
+
+// the value is matched case-insensitively and returned in lower case
+static std::optional<std::string>
+load_choice(YAML::Node const& node, std::string_view key,
+            std::initializer_list<std::string_view> choices)
+{
+  if (!node.IsDefined()) {
+    return {};
+  }
+
+  if (node.IsNull()) {
+    throw std::runtime_error{fmt::format("{} is null", key)};
+  }
+
+  auto value = algo::to_lower_copy(node.as<std::string>(""));
+  if (std::find(choices.begin(), choices.end(), value) != choices.end()) {
+    return value;
+  }
+  throw std::runtime_error{
+      fmt::format("invalid '{}' entry in configuration", key)};
+}
+
+static DatabaseConfiguration load_database(YAML::Node const& node)
+{
+  DatabaseConfiguration result;
+
+  if (!node.IsDefined()) {
+    return result;
+  }
+
+  if (!node.IsMap()) {
+    throw std::runtime_error{"invalid 'database' entry in configuration"};
+  }
+
+  if (auto const& path = node["path"]; path.IsDefined()) {
+    if (path.IsNull() || path.as<std::string>("").empty()) {
+      throw std::runtime_error{"database.path is null"};
+    }
+    result.path = path.as<std::string>();
+  }
+
+  if (auto maybe = load_choice(
+          node["journal-mode"], "database.journal-mode",
+          {"delete", "truncate", "persist", "memory", "wal", "off"})) {
+    result.journal_mode = std::move(*maybe);
+  }
+
+  if (auto maybe = load_choice(node["synchronous"], "database.synchronous",
+                               {"off", "normal", "full", "extra"})) {
+    result.synchronous = std::move(*maybe);
+  }
+
+  using Limits = std::numeric_limits<long long>;
+
+  if (auto maybe = load_integer(node["mmap-size"], "database.mmap-size", 0LL,
+                                Limits::max())) {
+    result.mmap_size = *maybe;
+  }
+
+  if (auto maybe = load_integer(node["cache-size"], "database.cache-size",
+                                Limits::min(), Limits::max())) {
+    result.cache_size = *maybe;
+  }
+
+  if (auto maybe = load_integer(node["busy-timeout"], "database.busy-timeout",
+                                0LL, static_cast<long long>(INT_MAX))) {
+    result.busy_timeout = *maybe;
+  }
+
+  return result;
+}
+
+static LocalityCacheConfiguration load_locality_cache(YAML::Node const& node)
+{
+  LocalityCacheConfiguration result;
+
+  if (!node.IsDefined()) {
+    return result;
+  }
+
+  if (!node.IsMap()) {
+    throw std::runtime_error{
+        "invalid 'locality-cache' entry in configuration"};
+  }
+
+  if (auto maybe =
+          load_integer(node["capacity"], "locality-cache.capacity",
+                       std::size_t{0}, std::size_t{100'000'000})) {
+    result.capacity = *maybe;
+  }
+
+  if (auto maybe = load_integer(node["ttl"], "locality-cache.ttl", 0LL,
+                                24LL * 3600)) {
+    result.ttl = *maybe;
+  }
+
+  if (auto const& inotify = node["inotify"]; inotify.IsDefined()) {
+    if (inotify.IsNull()) {
+      throw std::runtime_error{"locality-cache.inotify is null"};
+    }
+    if (!YAML::convert<bool>::decode(inotify, result.inotify)) {
+      throw std::runtime_error{
+          "invalid 'locality-cache.inotify' entry in configuration"};
+    }
+  }
+
+  return result;
+}
+
+static RequestLimits load_limits(YAML::Node const& node)
+{
+  RequestLimits result;
+
+  if (!node.IsDefined()) {
+    return result;
+  }
+
+  if (!node.IsMap()) {
+    throw std::runtime_error{"invalid 'limits' entry in configuration"};
+  }
+
+  using Limits = std::numeric_limits<std::size_t>;
+
+  if (auto maybe = load_integer(node["max-files"], "limits.max-files",
+                                std::size_t{1}, Limits::max())) {
+    result.max_files = *maybe;
+  }
+
+  if (auto maybe = load_integer(node["max-body-size"], "limits.max-body-size",
+                                std::size_t{1}, Limits::max())) {
+    result.max_body_size = *maybe;
+  }
+
+  return result;
+}
+
+static ReconcilerConfiguration load_reconciler(YAML::Node const& node)
+{
+  ReconcilerConfiguration result;
+
+  if (!node.IsDefined()) {
+    return result;
+  }
+
+  if (!node.IsMap()) {
+    throw std::runtime_error{"invalid 'reconciler' entry in configuration"};
+  }
+
+  if (auto maybe = load_integer(node["interval"], "reconciler.interval", 1LL,
+                                24LL * 3600)) {
+    result.interval = *maybe;
+  }
+
+  if (auto maybe =
+          load_integer(node["batch-size"], "reconciler.batch-size",
+                       std::size_t{1}, std::size_t{1'000'000})) {
+    result.batch_size = *maybe;
+  }
+
+  return result;
+}
+
+static ProfilingConfiguration load_profiling(YAML::Node const& node)
+{
+  ProfilingConfiguration result;
+
+  if (!node.IsDefined()) {
+    return result;
+  }
+
+  if (!node.IsMap()) {
+    throw std::runtime_error{"invalid 'profiling' entry in configuration"};
+  }
+
+  if (auto const& enabled = node["enabled"]; enabled.IsDefined()) {
+    if (enabled.IsNull()) {
+      throw std::runtime_error{"profiling.enabled is null"};
+    }
+    if (!YAML::convert<bool>::decode(enabled, result.enabled)) {
+      throw std::runtime_error{
+          "invalid 'profiling.enabled' entry in configuration"};
+    }
+  }
+
+  if (auto maybe = load_integer(node["sampling"], "profiling.sampling",
+                                std::uint32_t{1}, std::uint32_t{1'000'000})) {
+    result.sampling = *maybe;
+  }
+
+  return result;
+}
+
+static AccessLogConfiguration load_access_log(YAML::Node const& node)
+{
+  AccessLogConfiguration result;
+
+  if (!node.IsDefined()) {
+    return result;
+  }
+
+  if (!node.IsMap()) {
+    throw std::runtime_error{"invalid 'access-log' entry in configuration"};
+  }
+
+  if (auto const& path = node["path"]; path.IsDefined()) {
+    if (path.IsNull() || path.as<std::string>("").empty()) {
+      throw std::runtime_error{"access-log.path is null"};
+    }
+    result.path = path.as<std::string>();
+  }
+
+  if (auto maybe = load_integer(node["buffer-size"], "access-log.buffer-size",
+                                std::size_t{64 * 1024},
+                                std::size_t{1024 * 1024 * 1024})) {
+    result.buffer_size = *maybe;
+  }
+
+  return result;
+}
+
 static Configuration load(YAML::Node const& node)
 {
   const auto sas_key = "storage-areas";
@@ -360,6 +610,31 @@ static Configuration load(YAML::Node const& node)
     }
   }
 
+  {
+    auto const key    = "concurrency";
+    auto const& value = node[key];
+    auto const maybe  = load_integer<std::uint16_t>(value, key, 1, 256);
+    if (maybe.has_value()) {
+      config.concurrency = *maybe;
+    }
+  }
+
+  {
+    auto const key    = "io-threads";
+    auto const& value = node[key];
+    auto const maybe  = load_integer<std::uint16_t>(value, key, 0, 256);
+    if (maybe.has_value()) {
+      config.io_threads = *maybe;
+    }
+  }
+
+  config.database       = load_database(node["database"]);
+  config.locality_cache = load_locality_cache(node["locality-cache"]);
+  config.limits         = load_limits(node["limits"]);
+  config.reconciler     = load_reconciler(node["reconciler"]);
+  config.profiling      = load_profiling(node["profiling"]);
+  config.access_log     = load_access_log(node["access-log"]);
+
   return config;
 }
 
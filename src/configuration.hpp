@@ -2,6 +2,7 @@
 #define CONFIGURATION_HPP
 
 #include "types.hpp"
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 #include <vector>
@@ -16,6 +17,67 @@ struct StorageArea
 };
 
 using StorageAreas = std::vector<StorageArea>;
+
+// SQLite settings, applied to every connection to the database
+// see https://www.sqlite.org/pragma.html for the meaning of the values
+struct DatabaseConfiguration
+{
+  Path path{"storm-tape.sqlite"};
+  std::string journal_mode{"wal"};
+  std::string synchronous{"normal"};
+  // bytes
+  long long mmap_size{0};
+  // pages if positive, KiB if negative
+  long long cache_size{-2'000};
+  // milliseconds
+  long long busy_timeout{60'000};
+};
+// cache of the status of the files on the storage
+struct LocalityCacheConfiguration
+{
+  // maximum number of cached files; 0 disables the cache
+  std::size_t capacity{100'000};
+  // seconds an entry stays valid; 0 disables the cache
+  long long ttl{10};
+  // invalidate the entries also on inotify events
+  bool inotify{false};
+};
+
+// limits on the requests accepted by the service
+struct RequestLimits
+{
+  // maximum number of files in a single request
+  std::size_t max_files{100'000};
+  // bytes
+  std::size_t max_body_size{64 * 1024 * 1024};
+};
+
+// background reconciliation of the state of the files with the storage
+struct ReconcilerConfiguration
+{
+  // seconds between two passes
+  long long interval{10};
+  // maximum number of files probed and updated together
+  std::size_t batch_size{1'000};
+};
+
+// tracing of the scopes marked with PROFILE_SCOPE, in builds with PROFILING
+struct ProfilingConfiguration
+{
+  // tracing can also be toggled at runtime with SIGUSR1
+  bool enabled{true};
+  // record one scope every sampling
+  std::uint32_t sampling{1};
+};
+
+struct AccessLogConfiguration
+{
+  // "-" is the standard output; the file is reopened on SIGHUP
+  Path path{"-"};
+  // bytes of lines waiting to be written, beyond which lines are dropped
+  std::size_t buffer_size{4 * 1024 * 1024};
+};
+
 // log levels match Crow's
 // 0 - Debug, 1 - Info, 2 - Warning, 3 - Error, 4 - Critical
 using LogLevel = int;
@@ -26,6 +88,18 @@ struct Configuration
   StorageAreas storage_areas;
   LogLevel log_level = 1;
   bool mirror_mode = false;
+  // number of threads serving HTTP requests, which is also the number of
+  // connections to the database
+  std::uint16_t concurrency = 1;
+  // number of threads issuing metadata calls to the storage in parallel; 0
+  // means that the calls are issued by the thread serving the request
+  std::uint16_t io_threads = 8;
+  DatabaseConfiguration database;
+  LocalityCacheConfiguration locality_cache;
+  RequestLimits limits;
+  ReconcilerConfiguration reconciler;
+  ProfilingConfiguration profiling;
+  AccessLogConfiguration access_log;
 };
 
 Configuration load_configuration(std::istream& is);
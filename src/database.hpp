@@ -70,6 +70,8 @@ class Database
   virtual std::size_t count_files(File::State state) const          = 0;
   virtual PhysicalPaths get_files(File::State state,
                                   std::size_t n_files) const        = 0;
+  // the distinct physical paths of the started files of the incomplete stages
+  virtual PhysicalPaths find_files_in_progress() const              = 0;
 };
 
 } // namespace storm
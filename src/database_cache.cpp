@@ -0,0 +1,490 @@
+#include "database_cache.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+
+namespace storm {
+
+namespace {
+
+// index in CachingDatabase::m_paths_by_state of the states tracked in memory
+std::optional<std::size_t> tracked(File::State state)
+{
+  switch (state) {
+  case File::State::submitted:
+    return 0;
+  case File::State::started:
+    return 1;
+  default:
+    return std::nullopt;
+  }
+}
+
+} // namespace
+
+CachingDatabase::CachingDatabase(Database& db)
+    : m_db{db}
+{
+  PROFILE_FUNCTION();
+  for (auto const& id : m_db.find_incomplete_stages()) {
+    if (auto const stage = m_db.find(id); stage.has_value()) {
+      add(id, make_stage(*stage));
+    }
+  }
+}
+
+// the expensive part of the caching of a stage, which does not need the lock
+CachingDatabase::CachedStage
+CachingDatabase::make_stage(StageRequest const& stage)
+{
+  // sort by logical path, as the rows returned by the underlying database
+  std::vector<File const*> files;
+  files.reserve(stage.files.size());
+  std::transform(stage.files.begin(), stage.files.end(),
+                 std::back_inserter(files), [](File const& f) { return &f; });
+  std::sort(files.begin(), files.end(), [](File const* a, File const* b) {
+    return a->logical_path.native() < b->logical_path.native();
+  });
+
+  CachedStage cached;
+  cached.created_at   = stage.created_at;
+  cached.started_at   = stage.started_at;
+  cached.completed_at = stage.completed_at;
+
+  auto const n_bytes = std::accumulate(
+      files.begin(), files.end(), std::size_t{0},
+      [](std::size_t acc, File const* f) {
+        return acc + f->physical_path.native().size();
+      });
+  cached.paths.reserve(files.size(), n_bytes);
+  cached.files.reserve(files.size());
+
+  for (File const* file : files) {
+    cached.paths.add(file->logical_path.native(),
+                     file->physical_path.native());
+    cached.files.push_back(CachedFile{{}, nullptr, file->state,
+                                      file->started_at, file->finished_at});
+  }
+
+  return cached;
+}
+
+void CachingDatabase::add(StageId const& id, CachedStage stage)
+{
+  auto const [it, inserted] = m_stages.try_emplace(id, std::move(stage));
+  assert(inserted && "stage already cached");
+
+  // the keys of m_files_by_path point into the buffer of the PathTable, which
+  // does not move any more
+  auto& cached = it->second;
+  for (std::size_t i = 0; i != cached.files.size(); ++i) {
+    auto& file = cached.files[i];
+    file.path  = cached.paths.physical(static_cast<PathTable::Index>(i));
+    auto const [entry, _] = m_files_by_path.try_emplace(file.path);
+    file.entry            = &*entry;
+    entry->second.push_back(&file);
+    if (auto const j = tracked(file.state); j.has_value()) {
+      m_paths_by_state[*j].insert(entry->first);
+    }
+  }
+}
+
+void CachingDatabase::remove(StageId const& id)
+{
+  auto const it = m_stages.find(id);
+  if (it == m_stages.end()) {
+    return;
+  }
+
+  for (auto& file : it->second.files) {
+    auto& [path, files] = *file.entry;
+    std::erase(files, &file);
+
+    if (auto const i = tracked(file.state);
+        i.has_value()
+        && std::none_of(files.begin(), files.end(), [&](CachedFile const* f) {
+             return f->state == file.state;
+           })) {
+      m_paths_by_state[*i].erase(path);
+    }
+    if (files.empty()) {
+      m_files_by_path.erase(m_files_by_path.find(path));
+    } else if (path.data() == file.path.data()) {
+      // the key points into the PathTable that is going away, move it to the
+      // PathTable of another file. Re-inserting the node keeps the entry at
+      // the same address
+      rekey(*file.entry, files.front()->path);
+    }
+  }
+
+  m_stages.erase(it);
+}
+
+void CachingDatabase::rekey(FilesByPath::value_type& entry,
+                            std::string_view path)
+{
+  // the views in m_paths_by_state point to the key as well
+  std::array<bool, 2> in_state{};
+  for (std::size_t i = 0; i != m_paths_by_state.size(); ++i) {
+    in_state[i] = m_paths_by_state[i].erase(entry.first) != 0;
+  }
+
+  auto node  = m_files_by_path.extract(m_files_by_path.find(entry.first));
+  node.key() = path;
+  m_files_by_path.insert(std::move(node));
+
+  for (std::size_t i = 0; i != m_paths_by_state.size(); ++i) {
+    if (in_state[i]) {
+      m_paths_by_state[i].insert(entry.first);
+    }
+  }
+}
+
+void CachingDatabase::set_state(CachedFile& file, File::State state)
+{
+  if (file.state == state) {
+    return;
+  }
+
+  auto const& [path, files] = *file.entry;
+
+  auto const old_state = file.state;
+  file.state           = state;
+
+  if (auto const i = tracked(old_state);
+      i.has_value()
+      && std::none_of(
+          files.begin(), files.end(),
+          [&](CachedFile const* f) { return f->state == old_state; })) {
+    m_paths_by_state[*i].erase(path);
+  }
+  if (auto const i = tracked(state); i.has_value()) {
+    m_paths_by_state[*i].insert(path);
+  }
+}
+
+// the following functions mirror the semantics of the corresponding updates
+// in SociDatabase
+
+void CachingDatabase::apply(CachedFile& file, File::State state,
+                            TimePoint tp)
+{
+  switch (state) {
+  case File::State::started:
+    set_state(file, state);
+    file.started_at = tp;
+    break;
+  case File::State::completed:
+  case File::State::cancelled:
+  case File::State::failed:
+    set_state(file, state);
+    if (file.started_at == 0) {
+      file.started_at = tp;
+    }
+    file.finished_at = tp;
+    break;
+  case File::State::submitted:
+    // this transition is not foreseen, ignore
+    break;
+  }
+}
+
+void CachingDatabase::apply(PhysicalPath const& path, File::State state,
+                            TimePoint tp)
+{
+  auto const entry = m_files_by_path.find(std::string_view{path.native()});
+  if (entry == m_files_by_path.end()) {
+    return;
+  }
+
+  for (CachedFile* file : entry->second) {
+    auto const current = file->state;
+    bool const applicable =
+        state == File::State::started
+            ? current == File::State::submitted
+            : current == File::State::submitted
+                  || current == File::State::started;
+    if (applicable) {
+      apply(*file, state, tp);
+    }
+  }
+}
+
+void CachingDatabase::apply(StageEntity const& entity)
+{
+  auto const it = m_stages.find(entity.id);
+  if (it == m_stages.end()) {
+    return;
+  }
+
+  auto& stage        = it->second;
+  stage.created_at   = entity.created_at;
+  stage.started_at   = entity.started_at;
+  stage.completed_at = entity.completed_at;
+
+  if (stage.completed_at != 0) {
+    remove(entity.id);
+  }
+}
+
+CachingDatabase::CachedFile*
+CachingDatabase::find_file(StageId const& id, LogicalPath const& path)
+{
+  auto const it = m_stages.find(id);
+  if (it == m_stages.end()) {
+    return nullptr;
+  }
+
+  // binary search on the logical paths, which have the same index as the files
+  auto const& paths = it->second.paths;
+  auto& files        = it->second.files;
+  auto const& key    = path.native();
+  std::size_t first{0};
+  std::size_t last{files.size()};
+  while (first != last) {
+    auto const mid = first + (last - first) / 2;
+    if (compare(paths.logical(static_cast<PathTable::Index>(mid)), key) < 0) {
+      first = mid + 1;
+    } else {
+      last = mid;
+    }
+  }
+  if (first == files.size()
+      || compare(paths.logical(static_cast<PathTable::Index>(first)), key)
+             != 0) {
+    return nullptr;
+  }
+  return &files[first];
+}
+
+bool CachingDatabase::insert(StageId const& id, StageRequest const& stage)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.insert(id, stage)) {
+    return false;
+  }
+  if (stage.completed_at == 0) {
+    auto cached = make_stage(stage);
+    std::unique_lock lock{m_mutex};
+    add(id, std::move(cached));
+  }
+  return true;
+}
+
+std::optional<StageRequest> CachingDatabase::find(StageId const& id) const
+{
+  PROFILE_FUNCTION();
+  {
+    std::shared_lock lock{m_mutex};
+    if (auto const it = m_stages.find(id); it != m_stages.end()) {
+      auto const& cached = it->second;
+      Files files;
+      files.reserve(cached.files.size());
+      for (std::size_t i = 0; i != cached.files.size(); ++i) {
+        auto const j     = static_cast<PathTable::Index>(i);
+        auto const& file = cached.files[i];
+        files.push_back(File{LogicalPath{cached.paths.logical(j).str()},
+                             PhysicalPath{cached.paths.physical(j)},
+                             file.state, Locality::unavailable,
+                             file.started_at, file.finished_at});
+      }
+      return StageRequest{std::move(files), cached.created_at,
+                          cached.started_at, cached.completed_at};
+    }
+  }
+  return m_db.find(id);
+}
+
+std::vector<StageId> CachingDatabase::find_incomplete_stages() const
+{
+  PROFILE_FUNCTION();
+  std::shared_lock lock{m_mutex};
+  std::vector<StageId> result;
+  result.reserve(m_stages.size());
+  std::transform(m_stages.begin(), m_stages.end(), std::back_inserter(result),
+                 [](auto const& e) { return e.first; });
+  return result;
+}
+
+bool CachingDatabase::update(StageId const& id, LogicalPath const& path,
+                             File::State state)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.update(id, path, state)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  if (auto* file = find_file(id, path); file != nullptr) {
+    set_state(*file, state);
+  }
+  return true;
+}
+
+bool CachingDatabase::update(StageId const& id, LogicalPath const& path,
+                             File::State state, TimePoint tp)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.update(id, path, state, tp)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  if (auto* file = find_file(id, path); file != nullptr) {
+    apply(*file, state, tp);
+  }
+  return true;
+}
+
+bool CachingDatabase::update(PhysicalPath const& path, File::State state,
+                             TimePoint tp)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.update(path, state, tp)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  apply(path, state, tp);
+  return true;
+}
+
+bool CachingDatabase::update(StageId const& id,
+                             std::span<LogicalPath const> paths,
+                             File::State state, TimePoint tp)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.update(id, paths, state, tp)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  for (auto const& path : paths) {
+    if (auto* file = find_file(id, path); file != nullptr) {
+      apply(*file, state, tp);
+    }
+  }
+  return true;
+}
+
+bool CachingDatabase::update(std::span<PhysicalPath const> paths,
+                             File::State state, TimePoint tp)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.update(paths, state, tp)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  for (auto const& path : paths) {
+    apply(path, state, tp);
+  }
+  return true;
+}
+
+bool CachingDatabase::update(
+    std::span<std::pair<PhysicalPath, File::State>> path_states, TimePoint tp)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  // the equivalent overload of the underlying database is private
+  if (!m_db.update(StageUpdate{std::nullopt, path_states, tp})) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  for (auto const& [path, state] : path_states) {
+    apply(path, state, tp);
+  }
+  return true;
+}
+
+bool CachingDatabase::update(StageEntity const& entity)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  // the equivalent overload of the underlying database is private
+  if (!m_db.update(StageUpdate{entity, {}, 0})) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  apply(entity);
+  return true;
+}
+
+bool CachingDatabase::update(StageUpdate const& stage_update)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.update(stage_update)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  for (auto const& [path, state] : stage_update.files) {
+    apply(path, state, stage_update.tp);
+  }
+  // the stage may leave the cache, so update it last
+  if (stage_update.stage.has_value()) {
+    apply(*stage_update.stage);
+  }
+  return true;
+}
+
+bool CachingDatabase::erase(StageId const& id)
+{
+  PROFILE_FUNCTION();
+  std::lock_guard write_lock{m_write_mutex};
+  if (!m_db.erase(id)) {
+    return false;
+  }
+  std::unique_lock lock{m_mutex};
+  remove(id);
+  return true;
+}
+
+std::size_t CachingDatabase::count_files(File::State state) const
+{
+  PROFILE_FUNCTION();
+  if (auto const i = tracked(state); i.has_value()) {
+    std::shared_lock lock{m_mutex};
+    return m_paths_by_state[*i].size();
+  }
+  return m_db.count_files(state);
+}
+
+PhysicalPaths CachingDatabase::get_files(File::State state,
+                                         std::size_t n_files) const
+{
+  PROFILE_FUNCTION();
+  if (auto const i = tracked(state); i.has_value()) {
+    std::shared_lock lock{m_mutex};
+    auto const& paths = m_paths_by_state[*i];
+    PhysicalPaths result;
+    result.reserve(std::min(n_files, paths.size()));
+    for (auto it = paths.begin(); it != paths.end() && result.size() < n_files;
+         ++it) {
+      result.emplace_back(std::string{*it});
+    }
+    return result;
+  }
+  return m_db.get_files(state, n_files);
+}
+
+PhysicalPaths CachingDatabase::find_files_in_progress() const
+{
+  PROFILE_FUNCTION();
+  // all the cached stages are incomplete
+  std::shared_lock lock{m_mutex};
+  auto const& paths = m_paths_by_state[*tracked(File::State::started)];
+  PhysicalPaths result;
+  result.reserve(paths.size());
+  for (auto const path : paths) {
+    result.emplace_back(std::string{path});
+  }
+  return result;
+}
+
+} // namespace storm
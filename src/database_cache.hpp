@@ -0,0 +1,128 @@
+#ifndef STORM_TAPE_DATABASE_CACHE_HPP
+#define STORM_TAPE_DATABASE_CACHE_HPP
+
+#include "database.hpp"
+#include "path_table.hpp"
+#include <array>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace storm {
+
+// Write-through cache in front of another Database.
+//
+// All the incomplete stages are kept in memory, so that the queries on them
+// (find, count_files and get_files for submitted and started files,
+// find_files_in_progress) do not
+// hit the underlying database. Mutations are first applied to the underlying
+// database and then, if successful, to the cache; the lock that protects the
+// cache is taken only for the latter, so that the queries are not blocked by a
+// write in progress. A stage leaves the cache
+// when it completes or is erased; queries about completed stages are forwarded
+// to the underlying database.
+class CachingDatabase : public Database
+{
+  struct CachedFile;
+
+  // transparent, so that a lookup does not need to build a key
+  struct PathHash
+  {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view path) const noexcept
+    {
+      return std::hash<std::string_view>{}(path);
+    }
+  };
+
+  // all the cached files, indexed by physical path. A key points into the
+  // PathTable of the stage of one of its files; see remove
+  using FilesByPath = std::unordered_map<std::string_view,
+                                         std::vector<CachedFile*>, PathHash,
+                                         std::equal_to<>>;
+
+  // the paths of a file are kept in the PathTable of its stage
+  struct CachedFile
+  {
+    // the physical path, in the PathTable of the stage
+    std::string_view path;
+    // the entry of the file in m_files_by_path
+    FilesByPath::value_type* entry;
+    File::State state;
+    TimePoint started_at;
+    TimePoint finished_at;
+  };
+
+  // the files of a stage are kept sorted by logical path, with the same index
+  // as their paths, and never move, so that they can be referenced by the path
+  // index
+  struct CachedStage
+  {
+    PathTable paths;
+    std::vector<CachedFile> files;
+    TimePoint created_at;
+    TimePoint started_at;
+    TimePoint completed_at;
+  };
+
+  Database& m_db;
+  // serializes the mutations, so that they reach the cache in the same order
+  // as the underlying database
+  std::mutex m_write_mutex;
+  // protects the cache
+  mutable std::shared_mutex m_mutex;
+
+  std::map<StageId, CachedStage> m_stages;
+
+  FilesByPath m_files_by_path;
+
+  // the physical paths with at least one file in the submitted or started
+  // state, pointing to the keys of m_files_by_path
+  std::array<std::set<std::string_view>, 2> m_paths_by_state;
+
+  bool update(std::span<std::pair<PhysicalPath, File::State>> path_states,
+              TimePoint tp) override;
+  bool update(StageEntity const& entity) override;
+
+  static CachedStage make_stage(StageRequest const& stage);
+  void add(StageId const& id, CachedStage stage);
+  void remove(StageId const& id);
+  void rekey(FilesByPath::value_type& entry, std::string_view path);
+  void set_state(CachedFile& file, File::State state);
+  void apply(CachedFile& file, File::State state, TimePoint tp);
+  void apply(PhysicalPath const& path, File::State state, TimePoint tp);
+  void apply(StageEntity const& entity);
+  CachedFile* find_file(StageId const& id, LogicalPath const& path);
+
+ public:
+  // load all the incomplete stages from the underlying database
+  explicit CachingDatabase(Database& db);
+  bool insert(StageId const& id, StageRequest const& stage) override;
+  std::optional<StageRequest> find(StageId const& id) const override;
+  std::vector<StageId> find_incomplete_stages() const override;
+  bool update(StageId const& id, LogicalPath const& path,
+              File::State state) override;
+  bool update(StageId const& id, LogicalPath const& path, File::State state,
+              TimePoint tp) override;
+  bool update(PhysicalPath const& path, File::State state,
+              TimePoint tp) override;
+  bool update(StageId const& id, std::span<LogicalPath const> paths,
+              File::State state, TimePoint tp) override;
+  bool update(std::span<PhysicalPath const> paths, File::State state,
+              TimePoint tp) override;
+  bool update(StageUpdate const& stage_update) override;
+  bool erase(StageId const& id) override;
+  std::size_t count_files(File::State state) const override;
+  PhysicalPaths get_files(File::State state,
+                          std::size_t n_files) const override;
+  PhysicalPaths find_files_in_progress() const override;
+};
+
+} // namespace storm
+
+#endif // STORM_TAPE_DATABASE_CACHE_HPP
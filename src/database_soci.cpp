@@ -1,8 +1,15 @@
 #include "database_soci.hpp"
+#include "configuration.hpp"
 #include "io.hpp"
+#include "metrics.hpp"
 #include "profiler.hpp"
 #include "sql_queries.hpp"
+#include <crow/logging.h>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <soci/sqlite3/soci-sqlite3.h>
 #include <iostream>
+#include <stdexcept>
 
 namespace soci {
 template<>
@@ -83,36 +90,402 @@ std::vector<FileEntity> find_file_entities(const StageId& id,
   return files;
 }
 
+namespace {
+
+// The following functions operate on an explicit session, so that they can be
+// composed within a single transaction. The public member functions of
+// SociDatabase lease a session from the pool and forward to them.
+
+void update_file(soci::session& sql, StageId const& id,
+                 LogicalPath const& path, File::State state, TimePoint tp)
+{
+  auto const cstate = to_underlying(state);
+  auto const cpath  = path.string();
+  switch (state) {
+  case File::State::started: {
+    sql << "UPDATE File SET state = :state, started_at = :tp "
+           "WHERE stage_id = :id AND logical_path = :logical_path;",
+        soci::use(cstate), soci::use(tp), soci::use(id), soci::use(cpath);
+    break;
+  }
+  case File::State::completed:
+  case File::State::cancelled:
+  case File::State::failed: {
+    sql << "UPDATE File SET state = :state, "
+           "started_at = CASE WHEN started_at = 0 THEN :tp_start ELSE "
+           "started_at END, "
+           "finished_at = :tp_end "
+           "WHERE stage_id = :id AND logical_path = :logical_path;",
+        soci::use(cstate), soci::use(tp), soci::use(tp), soci::use(id),
+        soci::use(cpath);
+    break;
+  }
+  case File::State::submitted:
+    // this transition is not foreseen, ignore
+    break;
+  default:
+    assert(false && "invalid state");
+  }
+}
+
+void update_file(soci::session& sql, PhysicalPath const& path,
+                 File::State state, TimePoint tp)
+{
+  auto const new_state       = to_underlying(state);
+  auto const submitted_state = to_underlying(File::State::submitted);
+  auto const started_state   = to_underlying(File::State::started);
+  auto const cpath           = path.string();
+
+  switch (state) {
+  case File::State::started: {
+    using soci::use;
+    sql << "UPDATE File SET state = :state, started_at = :tp WHERE "
+           "physical_path = :physical_path AND state = :submitted;",
+        use(new_state), use(tp), use(cpath), use(submitted_state);
+    break;
+  }
+  case File::State::completed:
+  case File::State::cancelled:
+  case File::State::failed: {
+    using soci::use;
+    sql << "UPDATE File SET state = :state, "
+           "started_at = CASE WHEN started_at = 0 THEN :tp_start ELSE "
+           "started_at END, "
+           "finished_at = :tp_end "
+           "WHERE physical_path = :physical_path AND state IN (:submitted, "
+           ":started);",
+        use(new_state), use(tp), use(tp), use(cpath), use(submitted_state),
+        use(started_state);
+    break;
+  }
+  case File::State::submitted:
+    // this transition is not foreseen, ignore
+    break;
+  default:
+    assert(false && "invalid state");
+  }
+}
+
+// Replace the contents of the UpdatePath temporary table with the given paths
+template<typename Paths>
+void fill_update_paths(soci::session& sql, Paths const& paths)
+{
+  sql << storm::sql::UpdatePath::CREATE_IF_NOT_EXISTS;
+  sql << storm::sql::UpdatePath::CLEAR;
+
+  std::vector<std::string> cpaths;
+  cpaths.reserve(paths.size());
+  std::transform(paths.begin(), paths.end(), std::back_inserter(cpaths),
+                 [](auto const& path) { return path.string(); });
+  sql << storm::sql::UpdatePath::INSERT, soci::use(cpaths);
+}
+
+// Apply the same state transition to a set of files with a constant number of
+// statements, independently of the number of files
+void update_files(soci::session& sql, std::span<PhysicalPath const> paths,
+                  File::State state, TimePoint tp)
+{
+  if (paths.empty()) {
+    return;
+  }
+
+  auto const new_state       = to_underlying(state);
+  auto const submitted_state = to_underlying(File::State::submitted);
+  auto const started_state   = to_underlying(File::State::started);
+
+  switch (state) {
+  case File::State::started: {
+    using soci::use;
+    fill_update_paths(sql, paths);
+    sql << storm::sql::File::START_BY_PHYSICAL_PATHS, use(new_state), use(tp),
+        use(submitted_state);
+    break;
+  }
+  case File::State::completed:
+  case File::State::cancelled:
+  case File::State::failed: {
+    using soci::use;
+    fill_update_paths(sql, paths);
+    sql << storm::sql::File::FINISH_BY_PHYSICAL_PATHS, use(new_state), use(tp),
+        use(tp), use(submitted_state), use(started_state);
+    break;
+  }
+  case File::State::submitted:
+    // this transition is not foreseen, ignore
+    break;
+  default:
+    assert(false && "invalid state");
+  }
+}
+
+void update_files(soci::session& sql, StageId const& id,
+                  std::span<LogicalPath const> paths, File::State state,
+                  TimePoint tp)
+{
+  if (paths.empty()) {
+    return;
+  }
+
+  auto const new_state = to_underlying(state);
+
+  switch (state) {
+  case File::State::started: {
+    using soci::use;
+    fill_update_paths(sql, paths);
+    sql << storm::sql::File::START_BY_LOGICAL_PATHS, use(new_state), use(tp),
+        use(id);
+    break;
+  }
+  case File::State::completed:
+  case File::State::cancelled:
+  case File::State::failed: {
+    using soci::use;
+    fill_update_paths(sql, paths);
+    sql << storm::sql::File::FINISH_BY_LOGICAL_PATHS, use(new_state), use(tp),
+        use(tp), use(id);
+    break;
+  }
+  case File::State::submitted:
+    // this transition is not foreseen, ignore
+    break;
+  default:
+    assert(false && "invalid state");
+  }
+}
+
+// Group the files by target state and apply one batched update per state
+void update_files(
+    soci::session& sql,
+    std::span<std::pair<PhysicalPath, File::State>> path_states, TimePoint tp)
+{
+  PhysicalPaths paths;
+  paths.reserve(path_states.size());
+  for (auto state : {File::State::started, File::State::completed,
+                     File::State::cancelled, File::State::failed}) {
+    paths.clear();
+    for (auto const& [path, path_state] : path_states) {
+      if (path_state == state) {
+        paths.push_back(path);
+      }
+    }
+    update_files(sql, paths, state, tp);
+  }
+}
+
+void update_stage(soci::session& sql, StageEntity const& entity)
+{
+  using namespace soci;
+  sql << "UPDATE Stage SET created_at = :created_at, "
+         "started_at = :started_at, completed_at = :completed_at "
+         "WHERE id = :id;",
+      use(entity.created_at), use(entity.started_at), use(entity.completed_at),
+      use(entity.id);
+}
+
+// Insert the files of a stage through a statement that is prepared once and
+// bound to vectors, so that each execution inserts a whole batch of rows.
+// The batch size bounds the memory needed for the column vectors.
+void insert_files(soci::session& sql, StageId const& id, Files const& files)
+{
+  constexpr std::size_t batch_size{10'000};
+
+  if (files.empty()) {
+    return;
+  }
+
+  auto const n = std::min(files.size(), batch_size);
+  std::vector<std::string> stage_ids(n, id);
+  std::vector<std::string> logical_paths;
+  std::vector<std::string> physical_paths;
+  std::vector<int> states;
+  std::vector<int> localities(n, 0);
+  std::vector<TimePoint> started_ats;
+  std::vector<TimePoint> finished_ats;
+  logical_paths.reserve(n);
+  physical_paths.reserve(n);
+  states.reserve(n);
+  started_ats.reserve(n);
+  finished_ats.reserve(n);
+
+  auto fill = [&](auto first, auto last) {
+    logical_paths.clear();
+    physical_paths.clear();
+    states.clear();
+    started_ats.clear();
+    finished_ats.clear();
+    std::for_each(first, last, [&](File const& f) {
+      logical_paths.push_back(f.logical_path.string());
+      physical_paths.push_back(f.physical_path.string());
+      states.push_back(to_underlying(f.state));
+      started_ats.push_back(f.started_at);
+      finished_ats.push_back(f.finished_at);
+    });
+    auto const size = logical_paths.size();
+    stage_ids.resize(size, id);
+    localities.resize(size, 0);
+  };
+
+  auto first = files.begin();
+  auto last  = first + static_cast<std::ptrdiff_t>(n);
+  fill(first, last);
+
+  using soci::use;
+  soci::statement st =
+      (sql.prepare << storm::sql::File::INSERT, use(stage_ids),
+       use(logical_paths), use(physical_paths), use(states), use(localities),
+       use(started_ats), use(finished_ats));
+
+  while (true) {
+    st.execute(true);
+    if (last == files.end()) {
+      break;
+    }
+    first = last;
+    last  = first
+         + std::min(static_cast<std::ptrdiff_t>(batch_size),
+                    std::distance(first, files.end()));
+    fill(first, last);
+  }
+}
+
+// Bring the schema of the database up to date, applying in a single
+// transaction all the migrations that follow the current schema version
+void migrate(soci::session& sql)
+{
+  auto const& migrations = storm::sql::Schema::MIGRATIONS;
+  auto const latest      = static_cast<int>(migrations.size());
+
+  soci::transaction tr{sql};
+
+  int version{0};
+  sql << storm::sql::Schema::GET_VERSION, soci::into(version);
+
+  if (version < 0 || version > latest) {
+    throw std::runtime_error{
+        fmt::format("unsupported database schema version {} (latest is {})",
+                    version, latest)};
+  }
+
+  for (; version != latest; ++version) {
+    auto const& migration = migrations[static_cast<std::size_t>(version)];
+    for (auto const* statement : migration) {
+      sql << statement;
+    }
+    sql << fmt::format(storm::sql::Schema::SET_VERSION, version + 1);
+    CROW_LOG_INFO << fmt::format("Database schema migrated to version {}",
+                                 version + 1);
+  }
+
+  tr.commit();
+}
+
+// Rebuild from scratch the summary of the distinct physical paths per state,
+// which is normally kept up to date by triggers on the File table. Any
+// difference with the previous summary is reported.
+void rebuild_path_counters(soci::session& sql)
+{
+  // one row for each File::State
+  auto const n_states = to_underlying(File::State::completed) + 1u;
+  std::vector<int> states(n_states);
+  std::vector<long long> before(n_states);
+  std::vector<long long> after(n_states);
+
+  soci::transaction tr{sql};
+  sql << storm::sql::StateCount::FIND_ALL, soci::into(states),
+      soci::into(before);
+  sql << storm::sql::PathState::CLEAR;
+  sql << storm::sql::PathState::REBUILD;
+  sql << storm::sql::StateCount::REBUILD;
+  sql << storm::sql::StateCount::FIND_ALL, soci::into(states),
+      soci::into(after);
+  tr.commit();
+
+  if (before != after) {
+    CROW_LOG_WARNING << fmt::format(
+        "Inconsistent path counters in the database, rebuilt: {} -> {}",
+        fmt::join(before, ","), fmt::join(after, ","));
+  }
+}
+
+} // namespace
+
+std::unique_ptr<soci::connection_pool>
+make_sqlite_pool(std::size_t size, DatabaseConfiguration const& conf)
+{
+  assert(size > 0);
+  auto pool = std::make_unique<soci::connection_pool>(size);
+  auto const connect_string = fmt::format("db={}", conf.path.string());
+  for (std::size_t i = 0; i != size; ++i) {
+    auto& sql = pool->at(i);
+    sql.open(soci::sqlite3, connect_string);
+    // the busy timeout makes a connection wait for a lock held by another
+    // connection of the pool, instead of failing immediately
+    sql << fmt::format("PRAGMA busy_timeout = {}", conf.busy_timeout);
+    // journal_mode returns the mode actually in use, e.g. if WAL is not
+    // supported by the filesystem
+    std::string journal_mode;
+    sql << fmt::format("PRAGMA journal_mode = {}", conf.journal_mode),
+        soci::into(journal_mode);
+    sql << fmt::format("PRAGMA synchronous = {}", conf.synchronous);
+    sql << fmt::format("PRAGMA mmap_size = {}", conf.mmap_size);
+    sql << fmt::format("PRAGMA cache_size = {}", conf.cache_size);
+  }
+  CROW_LOG_INFO << fmt::format("Opened {} connection(s) to database '{}'",
+                               size, conf.path.string());
+  return pool;
+}
+
 // ---------------------
 // SociDatabase
 
-SociDatabase::SociDatabase(soci::session& sql)
-    : m_sql{sql}
+SociDatabase::SociDatabase(soci::connection_pool& pool)
+    : m_pool{pool}
 {
-  m_sql << storm::sql::Stage::CREATE_IF_NOT_EXISTS;
-  m_sql << storm::sql::File::CREATE_IF_NOT_EXISTS;
+  soci::session sql{m_pool};
+  migrate(sql);
+  rebuild_path_counters(sql);
+
+  // report the settings as actually applied by SQLite
+  std::string journal_mode;
+  int synchronous{};
+  long long mmap_size{};
+  long long cache_size{};
+  long long busy_timeout{};
+  sql << "PRAGMA journal_mode", soci::into(journal_mode);
+  sql << "PRAGMA synchronous", soci::into(synchronous);
+  sql << "PRAGMA mmap_size", soci::into(mmap_size);
+  sql << "PRAGMA cache_size", soci::into(cache_size);
+  sql << "PRAGMA busy_timeout", soci::into(busy_timeout);
+  CROW_LOG_INFO << fmt::format(
+      "Database settings: journal_mode={} synchronous={} mmap_size={} "
+      "cache_size={} busy_timeout={}",
+      journal_mode, synchronous, mmap_size, cache_size, busy_timeout);
+}
+
+int SociDatabase::schema_version() const
+{
+  soci::session sql{m_pool};
+  int version{0};
+  sql << storm::sql::Schema::GET_VERSION, soci::into(version);
+  return version;
 }
 
 bool SociDatabase::insert(StageId const& id, StageRequest const& stage)
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_insert};
   StageEntity s_entity{id, stage.created_at, stage.started_at,
                        stage.completed_at};
 
   try {
-    soci::transaction tr{m_sql};
+    soci::session sql{m_pool};
+    soci::transaction tr{sql};
 
     // Insert stage
-    m_sql << storm::sql::Stage::INSERT, soci::use(s_entity);
+    sql << storm::sql::Stage::INSERT, soci::use(s_entity);
 
     // Insert files
-    const auto& files = stage.files;
-    std::for_each(files.begin(), files.end(), [&](auto const& f) {
-      FileEntity const entity{id,           f.logical_path, f.physical_path,
-                              f.state,      f.locality,     f.started_at,
-                              f.finished_at};
-      m_sql << storm::sql::File::INSERT, soci::use(entity);
-    });
+    insert_files(sql, id, stage.files);
 
     tr.commit();
   } catch (soci::soci_error const& e) {
@@ -125,21 +498,26 @@ bool SociDatabase::insert(StageId const& id, StageRequest const& stage)
 std::optional<StageRequest> SociDatabase::find(StageId const& id) const
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_find};
+  soci::session sql{m_pool};
   StageEntity s_entity{};
-  m_sql << storm::sql::Stage::FIND, soci::into(s_entity), soci::use(id);
+  sql << storm::sql::Stage::FIND, soci::into(s_entity), soci::use(id);
 
   if (s_entity.id != id) {
     return std::nullopt;
   }
 
-  const auto f_entities = find_file_entities(id, m_sql);
+  auto f_entities = find_file_entities(id, sql);
   Files files;
   files.reserve(f_entities.size());
   std::transform(f_entities.begin(), f_entities.end(),
                  std::back_inserter(files), [](auto& fe) {
-                   return File{fe.logical_path, fe.physical_path,
-                               fe.state,        fe.locality,
-                               fe.started_at,   fe.finished_at};
+                   return File{std::move(fe.logical_path),
+                               std::move(fe.physical_path),
+                               fe.state,
+                               fe.locality,
+                               fe.started_at,
+                               fe.finished_at};
                  });
 
   return StageRequest{std::move(files), s_entity.created_at,
@@ -149,9 +527,11 @@ std::optional<StageRequest> SociDatabase::find(StageId const& id) const
 std::vector<StageId> SociDatabase::find_incomplete_stages() const
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_find_incomplete_stages};
+  soci::session sql{m_pool};
 
   std::size_t n_stages{0};
-  m_sql << "SELECT COUNT(*) FROM Stage WHERE completed_at = 0",
+  sql << "SELECT COUNT(*) FROM Stage WHERE completed_at = 0",
       soci::into(n_stages);
 
   if (n_stages == 0) {
@@ -159,14 +539,14 @@ std::vector<StageId> SociDatabase::find_incomplete_stages() const
   }
 
   std::vector<StageId> result(n_stages);
-  m_sql << "SELECT id FROM Stage WHERE completed_at = 0", soci::into(result);
+  sql << "SELECT id FROM Stage WHERE completed_at = 0", soci::into(result);
 
   // NB an incomplete stage is a stage whose files are not all in a final state;
   // in such cases the completed_at timestamp is 0. Since the DB contains stale
-  // information, which is reconciled with reality only when a status is called,
-  // the result may include stages that are actually completed; this is not a
-  // problem for the current use, because the important thing is that the result
-  // includes all incomplete stages
+  // information, which is reconciled with reality periodically in the
+  // background, the result may include stages that are actually completed; this
+  // is not a problem for the current use, because the important thing is that
+  // the result includes all incomplete stages
 
   return result;
 }
@@ -175,11 +555,13 @@ bool SociDatabase::update(StageId const& id, LogicalPath const& path,
                           File::State state)
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_update_logical_path};
   try {
+    soci::session sql{m_pool};
     auto const cstate = to_underlying(state);
     auto const cpath  = path.string();
-    m_sql << "UPDATE File SET state = :state WHERE stage_id = :id AND "
-             "logical_path = :logical_path;",
+    sql << "UPDATE File SET state = :state WHERE stage_id = :id AND "
+           "logical_path = :logical_path;",
         soci::use(cstate), soci::use(id), soci::use(cpath);
   } catch (soci::soci_error const& e) {
     std::cerr << "Soci error: " << e.what() << '\n';
@@ -192,35 +574,10 @@ bool SociDatabase::update(StageId const& id, LogicalPath const& path,
                           File::State state, TimePoint tp)
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_update_logical_path};
   try {
-    auto const cstate = to_underlying(state);
-    auto const cpath  = path.string();
-    switch (state) {
-    case File::State::started: {
-      m_sql << "UPDATE File SET state = :state, started_at = :tp "
-               "WHERE stage_id = :id AND logical_path = :logical_path;",
-          soci::use(cstate), soci::use(tp), soci::use(id), soci::use(cpath);
-      break;
-    }
-    case File::State::completed:
-    case File::State::cancelled:
-    case File::State::failed: {
-      m_sql << "UPDATE File SET state = :state, "
-               "started_at = CASE WHEN started_at = 0 THEN :tp_start ELSE "
-               "started_at END, "
-               "finished_at = :tp_end "
-               "WHERE stage_id = :id AND logical_path = :logical_path;",
-          soci::use(cstate), soci::use(tp), soci::use(tp), soci::use(id),
-          soci::use(cpath);
-      break;
-    }
-    case File::State::submitted:
-      // this transition is not foreseen, ignore
-      break;
-    default:
-      assert(false && "invalid state");
-    }
-
+    soci::session sql{m_pool};
+    update_file(sql, id, path, state, tp);
   } catch (soci::soci_error const& e) {
     std::cerr << "Soci error: " << e.what() << '\n';
     return false;
@@ -232,40 +589,10 @@ bool SociDatabase::update(PhysicalPath const& path, File::State state,
                           TimePoint tp)
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_update_physical_path};
   try {
-    auto const new_state       = to_underlying(state);
-    auto const submitted_state = to_underlying(File::State::submitted);
-    auto const started_state   = to_underlying(File::State::started);
-    auto const cpath           = path.string();
-
-    switch (state) {
-    case File::State::started: {
-      using soci::use;
-      m_sql << "UPDATE File SET state = :state, started_at = :tp WHERE "
-               "physical_path = :physical_path AND state = :submitted;",
-          use(new_state), use(tp), use(cpath), use(submitted_state);
-      break;
-    }
-    case File::State::completed:
-    case File::State::cancelled:
-    case File::State::failed: {
-      using soci::use;
-      m_sql << "UPDATE File SET state = :state, "
-               "started_at = CASE WHEN started_at = 0 THEN :tp_start ELSE "
-               "started_at END, "
-               "finished_at = :tp_end "
-               "WHERE physical_path = :physical_path AND state IN (:submitted, "
-               ":started);",
-          use(new_state), use(tp), use(tp), use(cpath), use(submitted_state),
-          use(started_state);
-      break;
-    }
-    case File::State::submitted:
-      // this transition is not foreseen, ignore
-      break;
-    default:
-      assert(false && "invalid state");
-    }
+    soci::session sql{m_pool};
+    update_file(sql, path, state, tp);
   } catch (soci::soci_error const& e) {
     std::cerr << "SOCI error: " << e.what() << '\n';
     return false;
@@ -277,10 +604,16 @@ bool SociDatabase::update(StageId const& id, std::span<LogicalPath const> paths,
                           File::State state, TimePoint tp)
 {
   PROFILE_FUNCTION();
-  soci::transaction tr{m_sql};
-  std::for_each(paths.begin(), paths.end(),
-                [&](auto& p) { update(id, p, state, tp); });
-  tr.commit();
+  LatencyTimer const timer{Operation::db_update_logical_paths};
+  try {
+    soci::session sql{m_pool};
+    soci::transaction tr{sql};
+    update_files(sql, id, paths, state, tp);
+    tr.commit();
+  } catch (soci::soci_error const& e) {
+    std::cerr << "Soci error: " << e.what() << '\n';
+    return false;
+  }
   return true;
 }
 
@@ -288,10 +621,16 @@ bool SociDatabase::update(std::span<PhysicalPath const> paths,
                           File::State state, TimePoint tp)
 {
   PROFILE_FUNCTION();
-  soci::transaction tr{m_sql};
-  std::for_each(paths.begin(), paths.end(),
-                [&](auto& p) { update(p, state, tp); });
-  tr.commit();
+  LatencyTimer const timer{Operation::db_update_physical_paths};
+  try {
+    soci::session sql{m_pool};
+    soci::transaction tr{sql};
+    update_files(sql, paths, state, tp);
+    tr.commit();
+  } catch (soci::soci_error const& e) {
+    std::cerr << "Soci error: " << e.what() << '\n';
+    return false;
+  }
   return true;
 }
 
@@ -299,32 +638,33 @@ bool SociDatabase::update(
     std::span<std::pair<PhysicalPath, File::State>> path_states, TimePoint tp)
 {
   PROFILE_FUNCTION();
-  for (auto const& [path, state] : path_states) {
-    update(path, state, tp);
-  }
+  LatencyTimer const timer{Operation::db_update_path_states};
+  soci::session sql{m_pool};
+  soci::transaction tr{sql};
+  update_files(sql, path_states, tp);
+  tr.commit();
   return true;
 }
 
 bool SociDatabase::update(StageEntity const& entity)
 {
   PROFILE_FUNCTION();
-  using namespace soci;
-  m_sql << "UPDATE Stage SET created_at = :created_at, "
-           "started_at = :started_at, completed_at = :completed_at "
-           "WHERE id = :id;",
-      use(entity.created_at), use(entity.started_at), use(entity.completed_at),
-      use(entity.id);
+  LatencyTimer const timer{Operation::db_update_stage_entity};
+  soci::session sql{m_pool};
+  update_stage(sql, entity);
   return true;
 }
 
 bool SociDatabase::update(StageUpdate const& stage_update)
 {
   PROFILE_FUNCTION();
-  soci::transaction tr{m_sql};
+  LatencyTimer const timer{Operation::db_update_stage};
+  soci::session sql{m_pool};
+  soci::transaction tr{sql};
   if (stage_update.stage.has_value()) {
-    update(*stage_update.stage);
+    update_stage(sql, *stage_update.stage);
   }
-  update(stage_update.files, stage_update.tp);
+  update_files(sql, stage_update.files, stage_update.tp);
   tr.commit();
   return true;
 }
@@ -332,23 +672,26 @@ bool SociDatabase::update(StageUpdate const& stage_update)
 std::size_t SociDatabase::count_files(File::State state) const
 {
   PROFILE_FUNCTION();
-  std::size_t count{};
+  LatencyTimer const timer{Operation::db_count_files};
+  soci::session sql{m_pool};
+  long long count{};
   auto const cstate = to_underlying(state);
-  m_sql
-      << "SELECT COUNT(DISTINCT physical_path) FROM File WHERE state = :state;",
-      soci::into(count), soci::use(cstate);
-  return std::size_t{count};
+  // maintained by triggers, see StateCount
+  sql << storm::sql::StateCount::FIND, soci::into(count), soci::use(cstate);
+  return static_cast<std::size_t>(count);
 }
 
 PhysicalPaths SociDatabase::get_files(File::State state,
                                       std::size_t n_files) const
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_get_files};
+  soci::session sql{m_pool};
   std::vector<Filename> filenames(n_files);
   auto const cstate = to_underlying(state);
 
-  m_sql << "SELECT DISTINCT physical_path FROM File WHERE state = :state LIMIT "
-           ":n_files;",
+  sql << "SELECT DISTINCT physical_path FROM File WHERE state = :state LIMIT "
+         ":n_files;",
       soci::into(filenames), soci::use(cstate), soci::use(n_files);
 
   PhysicalPaths result;
@@ -359,19 +702,40 @@ PhysicalPaths SociDatabase::get_files(File::State state,
   return result;
 }
 
+PhysicalPaths SociDatabase::find_files_in_progress() const
+{
+  PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_find_files_in_progress};
+  soci::session sql{m_pool};
+  auto const cstate = to_underlying(File::State::started);
+
+  soci::rowset<std::string> const rs =
+      (sql.prepare << storm::sql::File::FIND_STARTED_IN_INCOMPLETE_STAGES,
+       soci::use(cstate));
+
+  PhysicalPaths result;
+  std::for_each(rs.begin(), rs.end(),
+                [&](auto& path) { result.emplace_back(std::move(path)); });
+  return result;
+}
+
 bool SociDatabase::erase(StageId const& id)
 {
   PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::db_erase};
   try {
+    soci::session sql{m_pool};
     int count{0};
-    m_sql << "SELECT count(*) FROM Stage WHERE id = :id;", soci::into(count),
+    sql << "SELECT count(*) FROM Stage WHERE id = :id;", soci::into(count),
         soci::use(id);
     if (count == 0) {
       return false;
     }
 
-    m_sql << "DELETE FROM File WHERE stage_id = :stage_id;", soci::use(id);
-    m_sql << "DELETE FROM Stage WHERE id = :id", soci::use(id);
+    soci::transaction tr{sql};
+    sql << "DELETE FROM File WHERE stage_id = :stage_id;", soci::use(id);
+    sql << "DELETE FROM Stage WHERE id = :id", soci::use(id);
+    tr.commit();
 
   } catch (soci::soci_error const& e) {
     std::cerr << "Soci error: " << e.what() << '\n';
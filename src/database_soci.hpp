@@ -4,18 +4,30 @@
 #include "database.hpp"
 
 #include <soci/soci.h>
+#include <memory>
 
 namespace storm {
 
+struct DatabaseConfiguration;
+
+// Create a pool of sessions, all connected to the same SQLite database and
+// tuned according to the configuration
+std::unique_ptr<soci::connection_pool>
+make_sqlite_pool(std::size_t size, DatabaseConfiguration const& conf);
+
+// Each operation leases a session from the pool for its whole duration, so
+// that concurrent requests do not share the same connection
 class SociDatabase : public Database
 {
-  soci::session& m_sql;
+  soci::connection_pool& m_pool;
 
   bool update(std::span<std::pair<PhysicalPath, File::State>> path_states, TimePoint tp) override;
   bool update(StageEntity const& entity) override;
   
  public:
-  explicit SociDatabase(soci::session& sql);
+  // the schema of the database is migrated to the latest version, if needed
+  explicit SociDatabase(soci::connection_pool& pool);
+  int schema_version() const;
   bool insert(StageId const& id, StageRequest const& stage) override;
   std::optional<StageRequest> find(std::string const& id) const override;
   std::vector<StageId> find_incomplete_stages() const override;
@@ -32,6 +44,7 @@ class SociDatabase : public Database
   bool erase(std::string const& id) override;
   std::size_t count_files(File::State state) const override;
   PhysicalPaths get_files(File::State state, std::size_t n_files) const override;
+  PhysicalPaths find_files_in_progress() const override;
 };
 
 } // namespace storm
@@ -35,6 +35,16 @@ class BadRequest : public HttpError
   }
 };
 
+class PayloadTooLarge : public HttpError
+{
+ public:
+  using HttpError::HttpError;
+  int status_code() const override
+  {
+    return 413;
+  }
+};
+
 class StageNotFound : public HttpError
 {
   static auto constexpr s_title       = "Stage not found";
@@ -0,0 +1,149 @@
+#include "inotify_watcher.hpp"
+#include "locality_cache.hpp"
+#include <crow/logging.h>
+#include <fmt/core.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+namespace storm {
+
+namespace {
+
+constexpr std::uint32_t watch_mask = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE
+                                   | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                   | IN_DELETE_SELF | IN_MOVE_SELF;
+
+} // namespace
+
+InotifyWatcher::InotifyWatcher(LocalityCache& cache)
+    : m_cache{cache}
+{
+  m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd == -1) {
+    throw std::system_error(errno, std::generic_category(),
+                            "cannot initialize inotify");
+  }
+  m_stop_fd = ::eventfd(0, EFD_CLOEXEC);
+  if (m_stop_fd == -1) {
+    auto const err = errno;
+    ::close(m_fd);
+    throw std::system_error(err, std::generic_category(),
+                            "cannot create eventfd");
+  }
+  m_thread = std::jthread{[this] { run(); }};
+}
+
+InotifyWatcher::~InotifyWatcher()
+{
+  std::uint64_t const one{1};
+  [[maybe_unused]] auto const res = ::write(m_stop_fd, &one, sizeof(one));
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  ::close(m_stop_fd);
+  ::close(m_fd);
+}
+
+void InotifyWatcher::watch(PhysicalPath const& file)
+{
+  auto const dir = file.parent_path();
+
+  std::lock_guard lock{m_mutex};
+  if (m_exhausted || m_dirs.contains(dir.native())) {
+    return;
+  }
+
+  auto const wd = ::inotify_add_watch(m_fd, dir.c_str(), watch_mask);
+  if (wd == -1) {
+    if (errno == ENOSPC) {
+      // rely on the time-to-live of the cache entries from now on
+      m_exhausted = true;
+      CROW_LOG_WARNING << "Reached the limit of inotify watches, see "
+                          "/proc/sys/fs/inotify/max_user_watches";
+    }
+    return;
+  }
+
+  m_dirs.insert(dir.native());
+  m_dirs_by_wd.emplace(wd, dir);
+}
+
+void InotifyWatcher::run()
+{
+  // aligned as required by inotify_event
+  alignas(inotify_event) std::array<char, 64 * 1024> buffer;
+  std::array<pollfd, 2> fds{pollfd{m_fd, POLLIN, 0},
+                            pollfd{m_stop_fd, POLLIN, 0}};
+
+  for (;;) {
+    if (::poll(fds.data(), fds.size(), -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      CROW_LOG_ERROR << fmt::format("inotify poll failed: {}",
+                                    std::strerror(errno));
+      m_cache.clear();
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+
+    auto const len = ::read(m_fd, buffer.data(), buffer.size());
+    if (len == -1 && (errno == EAGAIN || errno == EINTR)) {
+      continue;
+    }
+    if (len <= 0) {
+      CROW_LOG_ERROR << fmt::format(
+          "inotify read failed: {}",
+          len == 0 ? "end of file" : std::strerror(errno));
+      m_cache.clear();
+      return;
+    }
+
+    std::lock_guard lock{m_mutex};
+    for (auto p = buffer.data(); p < buffer.data() + len;) {
+      inotify_event event;
+      std::memcpy(&event, p, sizeof(event));
+      char const* name = p + sizeof(inotify_event);
+      p += sizeof(inotify_event) + event.len;
+
+      if ((event.mask & IN_Q_OVERFLOW) != 0) {
+        // some events have been lost
+        m_cache.clear();
+        continue;
+      }
+
+      auto const it = m_dirs_by_wd.find(event.wd);
+      if (it == m_dirs_by_wd.end()) {
+        continue;
+      }
+
+      if ((event.mask & IN_IGNORED) != 0) {
+        // the watch has been removed, e.g. because the directory is gone
+        m_dirs.erase(it->second.native());
+        m_dirs_by_wd.erase(it);
+        continue;
+      }
+
+      if ((event.mask & IN_MOVE_SELF) != 0) {
+        // the cached paths below the directory are not valid anymore
+        m_cache.clear();
+        continue;
+      }
+
+      if (event.len != 0) {
+        m_cache.invalidate(PhysicalPath{it->second / name});
+      }
+    }
+  }
+}
+
+} // namespace storm
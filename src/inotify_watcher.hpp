@@ -0,0 +1,49 @@
+#ifndef STORM_INOTIFY_WATCHER_HPP
+#define STORM_INOTIFY_WATCHER_HPP
+
+#include "types.hpp"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace storm {
+
+class LocalityCache;
+
+// Invalidate the entries of a LocalityCache when the corresponding files
+// change, as reported by inotify.
+//
+// The directories containing the cached files are watched, which catches the
+// changes to the xattrs (IN_ATTRIB), to the content and to the names of the
+// files. Note that inotify only reports changes done through the local
+// kernel: on a parallel filesystem the changes done on other nodes are not
+// seen, hence the time-to-live of the cache entries is still needed.
+class InotifyWatcher
+{
+  LocalityCache& m_cache;
+  int m_fd{-1};
+  // written to stop the thread
+  int m_stop_fd{-1};
+  std::mutex m_mutex;
+  std::unordered_map<int, Path> m_dirs_by_wd;
+  std::unordered_set<std::string> m_dirs;
+  bool m_exhausted{false};
+  std::jthread m_thread;
+
+  void run();
+
+ public:
+  explicit InotifyWatcher(LocalityCache& cache);
+  ~InotifyWatcher();
+  InotifyWatcher(InotifyWatcher const&)            = delete;
+  InotifyWatcher& operator=(InotifyWatcher const&) = delete;
+
+  // watch the directory containing the file, if not done already
+  void watch(PhysicalPath const& file);
+};
+
+} // namespace storm
+
+#endif // STORM_INOTIFY_WATCHER_HPP
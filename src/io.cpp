@@ -5,6 +5,8 @@
 #include "delete_response.hpp"
 #include "errors.hpp"
 #include "in_progress_response.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
 #include "readytakeover_response.hpp"
 #include "release_response.hpp"
 #include "stage_request.hpp"
@@ -14,6 +16,7 @@
 #include "takeover_response.hpp"
 #include "types.hpp"
 #include <boost/algorithm/string/join.hpp>
+#include <boost/json/basic_parser_impl.hpp>
 #include <boost/url/parse.hpp>
 #include <boost/variant2.hpp>
 #include <crow.h>
@@ -21,9 +24,12 @@
 #include <charconv>
 #include <chrono>
 #include <iomanip>
+#include <iterator>
 #include <numeric>
+#include <optional>
 #include <regex>
 #include <sstream>
+#include <string_view>
 
 namespace storm {
 
@@ -51,29 +57,95 @@ crow::response to_crow_response(StageResponse const& resp, HostInfo const& info)
   }
 }
 
+// Appends a JSON string, escaped as boost::json::serialize does.
+static void append_json_string(std::string& out, std::string_view s)
+{
+  static constexpr char hex[] = "0123456789abcdef";
+
+  out.push_back('"');
+  for (auto const c : s) {
+    switch (c) {
+    case '"':
+      out.append("\\\"");
+      break;
+    case '\\':
+      out.append("\\\\");
+      break;
+    case '\b':
+      out.append("\\b");
+      break;
+    case '\f':
+      out.append("\\f");
+      break;
+    case '\n':
+      out.append("\\n");
+      break;
+    case '\r':
+      out.append("\\r");
+      break;
+    case '\t':
+      out.append("\\t");
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        auto const u = static_cast<unsigned char>(c);
+        out.append("\\u00");
+        out.push_back(hex[u >> 4]);
+        out.push_back(hex[u & 0xf]);
+      } else {
+        out.push_back(c);
+      }
+    }
+  }
+  out.push_back('"');
+}
+
+// The body is written directly from the stage, without building an
+// intermediate JSON document, into a string reserved for the common case of
+// paths that need no escaping. The whole body is still materialized in memory
+// at each poll, in O(files) space: Crow offers no way to produce a response
+// body incrementally, so a bounded-memory streaming of the status is not
+// possible.
 crow::response to_crow_response(StatusResponse const& resp)
 {
-  auto const& stage   = resp.stage();
-  auto const& id      = resp.id();
-  auto const& m_files = stage.files;
-
-  boost::json::array files;
-  files.reserve(m_files.size());
-  std::transform( //
-      m_files.begin(), m_files.end(), std::back_inserter(files),
-      [](File const& file) {
-        return boost::json::object{{"path", file.logical_path.c_str()},
-                                   {"state", to_string(file.state)}};
+  PROFILE_FUNCTION();
+  auto const& stage = resp.stage();
+  auto const& files = stage.files;
+
+  constexpr std::string_view file_begin{R"({"path":)"};
+  constexpr std::string_view file_state{R"(,"state":)"};
+  constexpr std::string_view file_end{"},"};
+  // the quotes around the path and around the state, e.g. "COMPLETED"
+  constexpr std::size_t file_overhead =
+      file_begin.size() + file_state.size() + file_end.size() + 4 + 9;
+
+  auto const size = std::accumulate(
+      files.begin(), files.end(), std::size_t{128},
+      [&](std::size_t acc, File const& file) {
+        return acc + file.logical_path.native().size() + file_overhead;
       });
-  boost::json::object jbody;
-  jbody["id"]          = id;
-  jbody["createdAt"]   = stage.created_at;
-  jbody["startedAt"]   = stage.started_at;
-  jbody["completedAt"] = stage.completed_at;
-  jbody["files"]       = files;
 
-  return crow::response{crow::status::OK, "json",
-                        boost::json::serialize(jbody)};
+  std::string body;
+  body.reserve(size);
+  body.append(R"({"id":)");
+  append_json_string(body, resp.id());
+  fmt::format_to(std::back_inserter(body),
+                 R"(,"createdAt":{},"startedAt":{},"completedAt":{},"files":[)",
+                 stage.created_at, stage.started_at, stage.completed_at);
+  for (auto const& file : files) {
+    body.append(file_begin);
+    append_json_string(body, file.logical_path.native());
+    body.append(file_state);
+    append_json_string(body, to_string(file.state));
+    body.append(file_end);
+  }
+  if (!files.empty()) {
+    // the comma after the last file
+    body.pop_back();
+  }
+  body.append("]}");
+
+  return crow::response{crow::status::OK, "json", std::move(body)};
 }
 
 // Creates a JSON object when one or more files targeted for cancellation do
@@ -154,24 +226,67 @@ crow::response to_crow_response(ReadyTakeOverResponse const& resp) //-V835 for u
                         fmt::format("{}\n", resp.n_ready)};
 }
 
-crow::response to_crow_response(TakeOverResponse const& resp)
+// Prometheus text exposition format
+crow::response to_crow_response(Metrics const& metrics,
+                                LocalityCache::Stats const& stats)
 {
+  auto const metric = [](std::string_view name, std::string_view type,
+                         std::string_view help, auto value) {
+    return fmt::format("# HELP {0} {1}\n# TYPE {0} {2}\n{0} {3}\n", name, help,
+                       type, value);
+  };
   auto const body =
-      std::accumulate(resp.paths.begin(), resp.paths.end(), std::string{}, //
-                      [](std::string const& acc, PhysicalPath const& path) {
-                        return fmt::format("{}unused {}\n", acc, path.string());
-                      });
+      metrics.to_prometheus()
+      + metric("storm_tape_locality_cache_hits_total", "counter",
+               "Lookups answered by the locality cache", stats.hits)
+      + metric("storm_tape_locality_cache_misses_total", "counter",
+               "Lookups not answered by the locality cache", stats.misses)
+      + metric("storm_tape_locality_cache_evictions_total", "counter",
+               "Entries evicted from the locality cache to make room",
+               stats.evictions)
+      + metric("storm_tape_locality_cache_expirations_total", "counter",
+               "Entries of the locality cache found expired",
+               stats.expirations)
+      + metric("storm_tape_locality_cache_invalidations_total", "counter",
+               "Entries of the locality cache invalidated by a change",
+               stats.invalidations)
+      + metric("storm_tape_locality_cache_entries", "gauge",
+               "Entries in the locality cache", stats.size);
   return crow::response{crow::status::OK, "txt", body};
 }
 
+// One line per path, each starting with the prefix. The size of the body is
+// computed in advance, so that it is allocated only once.
+static std::string to_lines(PhysicalPaths const& paths,
+                            std::string_view prefix)
+{
+  auto const size = std::accumulate(
+      paths.begin(), paths.end(), std::size_t{0},
+      [&](std::size_t acc, PhysicalPath const& path) {
+        return acc + prefix.size() + path.native().size() + 1;
+      });
+
+  std::string body;
+  body.reserve(size);
+  for (auto const& path : paths) {
+    body.append(prefix);
+    body.append(path.native());
+    body.push_back('\n');
+  }
+  return body;
+}
+
+crow::response to_crow_response(TakeOverResponse const& resp)
+{
+  PROFILE_FUNCTION();
+  return crow::response{crow::status::OK, "txt",
+                        to_lines(resp.paths, "unused ")};
+}
+
 crow::response to_crow_response(InProgressResponse const& resp)
 {
-  auto const body =
-      std::accumulate(resp.paths.begin(), resp.paths.end(), std::string{}, //
-                      [](std::string const& acc, PhysicalPath const& path) {
-                        return fmt::format("{}{}\n", acc, path.string());
-                      });
-  return crow::response{crow::status::OK, "txt", body};
+  PROFILE_FUNCTION();
+  return crow::response{crow::status::OK, "txt", to_lines(resp.paths, "")};
 }
 
 crow::response to_crow_response(storm::HttpError const& e)
@@ -183,70 +298,349 @@ crow::response to_crow_response(storm::HttpError const& e)
   return response;
 }
 
-Files from_json(std::string_view body, StageRequest::Tag)
+namespace {
+
+// Handler for boost::json::basic_parser that collects the paths of a request
+// as the body is parsed, without building a DOM. The accepted bodies are
+//   {"files": [{"path": "<path>", ...}, ...], ...}
+//   {"paths": ["<path>", ...], ...}
+// the latter only if paths are accepted, in which case "paths" takes
+// precedence over "files". Any other member, at any level, is ignored.
+class PathsHandler
 {
-  try {
-    auto const value =
-        boost::json::parse(boost::json::string_view{body.data(), body.size()});
-    auto& jfiles = value.as_object().at("files").as_array();
-    Files files;
-    files.reserve(jfiles.size());
-
-    std::transform(                   //
-        jfiles.begin(), jfiles.end(), //
-        std::back_inserter(files),    //
-        [](auto& jfile) {
-          std::string_view sv = jfile.as_object().at("path").as_string();
-          return File{LogicalPath{Path{sv}.lexically_normal()}};
-        } //
-    );
-    return files;
-  } catch (boost::exception const&) {
-    throw BadRequest("Invalid JSON");
+  enum class Context : unsigned char
+  {
+    root,
+    paths,
+    files,
+    file
+  };
+
+  bool m_accept_paths;
+  std::size_t m_max_files;
+  std::vector<Context> m_contexts;
+  // nesting level within a value that is ignored
+  std::size_t m_skip{0};
+  std::string m_key;
+  std::string m_string;
+
+  bool m_has_paths{false};
+  bool m_has_files{false};
+  bool m_files_ok{false};
+  bool m_has_file_path{false};
+  bool m_too_many{false};
+  LogicalPaths m_paths;
+  LogicalPaths m_files;
+  LogicalPath m_file_path;
+
+  static bool fail(boost::json::error_code& ec)
+  {
+    ec = boost::json::error::syntax;
+    return false;
   }
-}
 
-LogicalPaths from_json(std::string_view body, RequestWithPaths::Tag)
-{
-  try {
-    LogicalPaths paths;
-    auto const value =
-        boost::json::parse(boost::json::string_view{body.data(), body.size()});
-
-    auto const& o = value.as_object();
-
-    if (auto const* p = o.if_contains("paths"); p != nullptr) {
-      auto const& ja = p->as_array();
-      paths.reserve(ja.size());
-
-      std::transform(                //
-          ja.begin(), ja.end(),      //
-          std::back_inserter(paths), //
-          [](auto& jpath) {
-            std::string_view sv = jpath.as_string();
-            return LogicalPath{Path{sv}.lexically_normal()};
-          } //
-      );
-
-    } else {
-      auto& ja = o.at("files").as_array();
-      paths.reserve(ja.size());
-
-      std::transform(                //
-          ja.begin(), ja.end(),      //
-          std::back_inserter(paths), //
-          [](auto& jfile) {
-            std::string_view sv = jfile.as_object().at("path").as_string();
-            return LogicalPath{Path{sv}.lexically_normal()};
-          } //
-      );
+  bool add(LogicalPaths& paths, std::string_view path,
+           boost::json::error_code& ec)
+  {
+    if (paths.size() == m_max_files) {
+      m_too_many = true;
+      return fail(ec);
+    }
+    paths.emplace_back(Path{path}.lexically_normal());
+    return true;
+  }
+
+  // the "files" entry is not as expected; that is fatal only if there is no
+  // alternative
+  bool invalid_files(bool is_container, boost::json::error_code& ec)
+  {
+    if (!m_accept_paths) {
+      return fail(ec);
+    }
+    m_files_ok = false;
+    m_skip     = is_container ? 1 : 0;
+    return true;
+  }
+
+  enum class Kind : unsigned char
+  {
+    object,
+    array,
+    string,
+    other
+  };
+
+  bool on_value(Kind kind, boost::json::error_code& ec)
+  {
+    bool const is_container = kind == Kind::object || kind == Kind::array;
+
+    if (m_contexts.empty()) {
+      // the root must be an object
+      if (kind != Kind::object) {
+        return fail(ec);
+      }
+      m_contexts.push_back(Context::root);
+      return true;
+    }
+
+    switch (m_contexts.back()) {
+    case Context::root:
+      if (m_accept_paths && m_key == "paths") {
+        if (kind != Kind::array) {
+          return fail(ec);
+        }
+        m_has_paths = true;
+        m_paths.clear();
+        m_contexts.push_back(Context::paths);
+      } else if (m_key == "files") {
+        m_has_files = true;
+        m_files_ok  = true;
+        m_files.clear();
+        if (kind != Kind::array) {
+          return invalid_files(is_container, ec);
+        }
+        m_contexts.push_back(Context::files);
+      } else if (is_container) {
+        m_skip = 1;
+      }
+      return true;
+
+    case Context::paths:
+      if (kind != Kind::string) {
+        return fail(ec);
+      }
+      return add(m_paths, m_string, ec);
+
+    case Context::files:
+      if (kind != Kind::object) {
+        return invalid_files(is_container, ec);
+      }
+      m_has_file_path = false;
+      m_contexts.push_back(Context::file);
+      return true;
+
+    case Context::file:
+      if (m_key == "path") {
+        if (kind != Kind::string) {
+          return invalid_files(is_container, ec);
+        }
+        m_file_path     = LogicalPath{m_string};
+        m_has_file_path = true;
+      } else if (is_container) {
+        m_skip = 1;
+      }
+      return true;
     }
 
-    return paths;
+    return true;
+  }
 
-  } catch (boost::exception const&) {
+  bool on_container_end(boost::json::error_code& ec)
+  {
+    if (m_skip != 0) {
+      --m_skip;
+      return true;
+    }
+    auto const context = m_contexts.back();
+    m_contexts.pop_back();
+    if (context == Context::file && m_files_ok) {
+      if (!m_has_file_path) {
+        return invalid_files(false, ec);
+      }
+      return add(m_files, m_file_path.native(), ec);
+    }
+    return true;
+  }
+
+  bool on_scalar(Kind kind, boost::json::error_code& ec)
+  {
+    return m_skip != 0 || on_value(kind, ec);
+  }
+
+ public:
+  static constexpr std::size_t max_object_size = std::size_t(-1);
+  static constexpr std::size_t max_array_size  = std::size_t(-1);
+  static constexpr std::size_t max_key_size    = std::size_t(-1);
+  static constexpr std::size_t max_string_size = std::size_t(-1);
+
+  PathsHandler(bool accept_paths, std::size_t max_files)
+      : m_accept_paths{accept_paths}
+      , m_max_files{max_files}
+  {}
+
+  bool too_many() const noexcept
+  {
+    return m_too_many;
+  }
+
+  // the collected paths, if the body is valid
+  std::optional<LogicalPaths> release()
+  {
+    if (m_has_paths) {
+      return std::move(m_paths);
+    }
+    if (m_has_files && m_files_ok) {
+      return std::move(m_files);
+    }
+    return std::nullopt;
+  }
+
+  bool on_document_begin(boost::json::error_code&)
+  {
+    return true;
+  }
+  bool on_document_end(boost::json::error_code&)
+  {
+    return true;
+  }
+  bool on_object_begin(boost::json::error_code& ec)
+  {
+    if (m_skip != 0) {
+      ++m_skip;
+      return true;
+    }
+    return on_value(Kind::object, ec);
+  }
+  bool on_object_end(std::size_t, boost::json::error_code& ec)
+  {
+    return on_container_end(ec);
+  }
+  bool on_array_begin(boost::json::error_code& ec)
+  {
+    if (m_skip != 0) {
+      ++m_skip;
+      return true;
+    }
+    return on_value(Kind::array, ec);
+  }
+  bool on_array_end(std::size_t, boost::json::error_code& ec)
+  {
+    return on_container_end(ec);
+  }
+  bool on_key_part(boost::json::string_view s, std::size_t n,
+                   boost::json::error_code&)
+  {
+    if (m_skip == 0) {
+      if (n == s.size()) {
+        m_key.clear();
+      }
+      m_key.append(s.data(), s.size());
+    }
+    return true;
+  }
+  bool on_key(boost::json::string_view s, std::size_t n,
+              boost::json::error_code& ec)
+  {
+    return on_key_part(s, n, ec);
+  }
+  bool on_string_part(boost::json::string_view s, std::size_t n,
+                      boost::json::error_code&)
+  {
+    if (m_skip == 0) {
+      if (n == s.size()) {
+        m_string.clear();
+      }
+      m_string.append(s.data(), s.size());
+    }
+    return true;
+  }
+  bool on_string(boost::json::string_view s, std::size_t n,
+                 boost::json::error_code& ec)
+  {
+    on_string_part(s, n, ec);
+    return on_scalar(Kind::string, ec);
+  }
+  bool on_number_part(boost::json::string_view, boost::json::error_code&)
+  {
+    return true;
+  }
+  bool on_int64(std::int64_t, boost::json::string_view,
+                boost::json::error_code& ec)
+  {
+    return on_scalar(Kind::other, ec);
+  }
+  bool on_uint64(std::uint64_t, boost::json::string_view,
+                 boost::json::error_code& ec)
+  {
+    return on_scalar(Kind::other, ec);
+  }
+  bool on_double(double, boost::json::string_view, boost::json::error_code& ec)
+  {
+    return on_scalar(Kind::other, ec);
+  }
+  bool on_bool(bool, boost::json::error_code& ec)
+  {
+    return on_scalar(Kind::other, ec);
+  }
+  bool on_null(boost::json::error_code& ec)
+  {
+    return on_scalar(Kind::other, ec);
+  }
+  bool on_comment_part(boost::json::string_view, boost::json::error_code&)
+  {
+    return true;
+  }
+  bool on_comment(boost::json::string_view, boost::json::error_code&)
+  {
+    return true;
+  }
+};
+
+LogicalPaths parse_paths(std::string_view body, bool accept_paths,
+                         RequestLimits const& limits)
+{
+  PROFILE_FUNCTION();
+  if (body.size() > limits.max_body_size) {
+    throw PayloadTooLarge(fmt::format("Request body larger than {} bytes",
+                                      limits.max_body_size));
+  }
+
+  boost::json::basic_parser<PathsHandler> parser{
+      boost::json::parse_options{}, accept_paths, limits.max_files};
+  boost::json::error_code ec;
+  auto const n = parser.write_some(false, body.data(), body.size(), ec);
+
+  if (parser.handler().too_many()) {
+    throw PayloadTooLarge(
+        fmt::format("Request with more than {} files", limits.max_files));
+  }
+  if (ec || n != body.size()) {
+    throw BadRequest("Invalid JSON");
+  }
+  auto paths = parser.handler().release();
+  if (!paths.has_value()) {
     throw BadRequest("Invalid JSON");
   }
+  return std::move(*paths);
+}
+
+} // namespace
+
+Files from_json(std::string_view body, StageRequest::Tag tag)
+{
+  return from_json(body, tag, RequestLimits{});
+}
+
+Files from_json(std::string_view body, StageRequest::Tag,
+                RequestLimits const& limits)
+{
+  auto paths = parse_paths(body, false, limits);
+  Files files;
+  files.reserve(paths.size());
+  std::transform(paths.begin(), paths.end(), std::back_inserter(files),
+                 [](LogicalPath& path) { return File{std::move(path)}; });
+  return files;
+}
+
+LogicalPaths from_json(std::string_view body, RequestWithPaths::Tag tag)
+{
+  return from_json(body, tag, RequestLimits{});
+}
+
+LogicalPaths from_json(std::string_view body, RequestWithPaths::Tag,
+                       RequestLimits const& limits)
+{
+  return parse_paths(body, true, limits);
 }
 
 void fill_hostinfo_from_forwarded(HostInfo& info,
@@ -7,6 +7,7 @@
 #include "stage_request.hpp"
 #include "takeover_request.hpp"
 #include "in_progress_request.hpp"
+#include "locality_cache.hpp"
 #include <boost/json.hpp>
 
 namespace crow {
@@ -27,6 +28,8 @@ class ReadyTakeOverResponse;
 class TakeOverResponse;
 class InProgressResponse;
 class Configuration;
+class Metrics;
+struct RequestLimits;
 
 struct HostInfo
 {
@@ -49,10 +52,18 @@ crow::response to_crow_response(ArchiveInfoResponse const& resp);
 crow::response to_crow_response(ReadyTakeOverResponse const& resp);
 crow::response to_crow_response(TakeOverResponse const& resp);
 crow::response to_crow_response(InProgressResponse const& resp);
+crow::response to_crow_response(Metrics const& metrics,
+                                LocalityCache::Stats const& stats);
 crow::response to_crow_response(storm::HttpError const& exception);
 
+// the bodies are parsed incrementally, without building a DOM; the versions
+// without limits use the default ones
 Files from_json(std::string_view body, StageRequest::Tag);
+Files from_json(std::string_view body, StageRequest::Tag,
+                RequestLimits const& limits);
 LogicalPaths from_json(std::string_view body, RequestWithPaths::Tag);
+LogicalPaths from_json(std::string_view body, RequestWithPaths::Tag,
+                       RequestLimits const& limits);
 
 void fill_hostinfo_from_forwarded(HostInfo& info, std::string const& http_forwarded);
 HostInfo get_hostinfo(crow::request const& req, Configuration const& conf);
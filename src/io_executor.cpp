@@ -0,0 +1,130 @@
+#include "io_executor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace storm {
+
+IoExecutor::IoExecutor(std::size_t n_threads)
+{
+  m_threads.reserve(n_threads);
+  for (std::size_t i = 0; i != n_threads; ++i) {
+    m_threads.emplace_back([this] { run(); });
+  }
+}
+
+IoExecutor::~IoExecutor()
+{
+  {
+    std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  // the threads are joined by the jthread destructors
+}
+
+void IoExecutor::submit(std::function<void()> task)
+{
+  {
+    std::lock_guard lock{m_mutex};
+    m_tasks.push_back(std::move(task));
+  }
+  m_cv.notify_one();
+}
+
+void IoExecutor::run()
+{
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock{m_mutex};
+      m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+      // drain the queue before stopping, someone may be waiting for the tasks
+      if (m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+namespace {
+
+// shared by the caller of for_each_index and its helpers. A helper that starts
+// when all the indexes have been claimed may outlive the call, so it must not
+// touch anything but this state
+struct ForEachState
+{
+  std::size_t n;
+  std::function<void(std::size_t)> const& f;
+  std::atomic<std::size_t> next{0};
+  std::mutex mutex;
+  std::condition_variable cv;
+  // indexes either processed or skipped after an error
+  std::size_t n_done{0};
+  std::exception_ptr error;
+
+  void work()
+  {
+    for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+         i      = next.fetch_add(1, std::memory_order_relaxed)) {
+      std::size_t n_finished{1};
+      std::exception_ptr e;
+      try {
+        f(i);
+      } catch (...) {
+        e = std::current_exception();
+      }
+      std::lock_guard lock{mutex};
+      if (e) {
+        if (!error) {
+          error = e;
+        }
+        // skip the indexes not yet claimed
+        if (auto const first = next.exchange(n, std::memory_order_relaxed);
+            first < n) {
+          n_finished += n - first;
+        }
+      }
+      n_done += n_finished;
+      if (n_done == n) {
+        cv.notify_all();
+      }
+    }
+  }
+};
+
+} // namespace
+
+void IoExecutor::for_each_index(std::size_t n,
+                                std::function<void(std::size_t)> const& f)
+{
+  if (n == 0) {
+    return;
+  }
+
+  // f can be referenced by the state because it is called only for a claimed
+  // index, and the caller waits for all of them
+  auto const state = std::make_shared<ForEachState>(n, f);
+
+  // the calling thread counts as one worker
+  auto const n_helpers = std::min(n - 1, m_threads.size());
+  for (std::size_t i = 0; i != n_helpers; ++i) {
+    submit([state] { state->work(); });
+  }
+  state->work();
+
+  // wait only for the indexes in progress on other threads, not for the
+  // helpers still in the queue
+  std::unique_lock lock{state->mutex};
+  state->cv.wait(lock, [&] { return state->n_done == n; });
+
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+} // namespace storm
@@ -0,0 +1,50 @@
+#ifndef STORM_IO_EXECUTOR_HPP
+#define STORM_IO_EXECUTOR_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace storm {
+
+// Fixed-size pool of threads dedicated to blocking I/O, e.g. the metadata
+// calls on the storage, so that many of them can be in flight at the same
+// time without occupying the threads that serve the HTTP requests.
+class IoExecutor
+{
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_tasks;
+  bool m_stop{false};
+  std::vector<std::jthread> m_threads;
+
+  void submit(std::function<void()> task);
+  void run();
+
+ public:
+  // with no threads all the work is done by the calling thread
+  explicit IoExecutor(std::size_t n_threads);
+  ~IoExecutor();
+  IoExecutor(IoExecutor const&)            = delete;
+  IoExecutor& operator=(IoExecutor const&) = delete;
+
+  std::size_t size() const noexcept
+  {
+    return m_threads.size();
+  }
+
+  // Call f(i) for each i in [0, n), in parallel, and return when all the calls
+  // have completed. The calling thread takes part in the work, so progress is
+  // guaranteed even if all the threads of the pool are busy. If a call throws,
+  // the remaining indexes are skipped and the first exception is rethrown.
+  void for_each_index(std::size_t n,
+                      std::function<void(std::size_t)> const& f);
+};
+
+} // namespace storm
+
+#endif // STORM_IO_EXECUTOR_HPP
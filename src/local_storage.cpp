@@ -1,12 +1,73 @@
 #include "local_storage.hpp"
 #include "extended_attributes.hpp"
+#include "metrics.hpp"
 #include "profiler.hpp"
+#ifdef STORM_IO_URING
+#include "uring_prober.hpp"
+#include <crow/logging.h>
+#include <fmt/core.h>
+#include <atomic>
+#include <exception>
+#include <memory>
+#endif
 #include <sys/stat.h>
+#include <sys/xattr.h>
+#include <cerrno>
+#include <string>
+#include <string_view>
 
 namespace storm {
 
+fs::file_type to_file_type(mode_t mode)
+{
+  if (S_ISREG(mode)) {
+    return fs::file_type::regular;
+  }
+  if (S_ISDIR(mode)) {
+    return fs::file_type::directory;
+  }
+  if (S_ISLNK(mode)) {
+    return fs::file_type::symlink;
+  }
+  if (S_ISBLK(mode)) {
+    return fs::file_type::block;
+  }
+  if (S_ISCHR(mode)) {
+    return fs::file_type::character;
+  }
+  if (S_ISFIFO(mode)) {
+    return fs::file_type::fifo;
+  }
+  if (S_ISSOCK(mode)) {
+    return fs::file_type::socket;
+  }
+  return fs::file_type::unknown;
+}
+
+namespace {
+
+// Read the list of xattr names of a file into buffer, which is reused across
+// calls and grown only if needed. Return the size of the list.
+ssize_t list_xattrs(PhysicalPath const& path, std::string& buffer)
+{
+  auto res = ::listxattr(path.c_str(), buffer.data(), buffer.size());
+  while (res < 0 && errno == ERANGE) {
+    // the list has grown in the meantime; query the actual size and retry
+    auto const size = ::listxattr(path.c_str(), nullptr, 0);
+    if (size < 0) {
+      return size;
+    }
+    buffer.resize(static_cast<std::size_t>(size));
+    res = ::listxattr(path.c_str(), buffer.data(), buffer.size());
+  }
+  return res;
+}
+
+} // namespace
+
 Result<bool> LocalStorage::is_in_progress(PhysicalPath const& path)
 {
+  LatencyTimer const timer{Operation::storage_is_in_progress};
   std::error_code ec;
   auto result = has_xattr(path, XAttrName{"user.TSMRecT"}, ec);
   if (ec == std::error_code{}) {
@@ -18,6 +79,7 @@ Result<bool> LocalStorage::is_in_progress(PhysicalPath const& path)
 
 Result<FileSizeInfo> LocalStorage::file_size_info(PhysicalPath const& path)
 {
+  LatencyTimer const timer{Operation::storage_file_size_info};
   struct stat sb = {};
 
   if (::stat(path.c_str(), &sb) == -1) {
@@ -31,6 +93,7 @@ Result<FileSizeInfo> LocalStorage::file_size_info(PhysicalPath const& path)
 
 Result<bool> LocalStorage::is_on_tape(PhysicalPath const& path)
 {
+  LatencyTimer const timer{Operation::storage_is_on_tape};
   std::error_code ec;
   auto result = has_xattr(path, XAttrName{"user.storm.migrated"}, ec);
   if (ec == std::error_code{}) {
@@ -40,4 +103,148 @@ Result<bool> LocalStorage::is_on_tape(PhysicalPath const& path)
   }
 }
 
+Result<void> LocalStorage::set_in_progress(PhysicalPath const& path)
+{
+  LatencyTimer const timer{Operation::storage_set_in_progress};
+  std::error_code ec;
+  create_xattr(path, XAttrName{"user.TSMRecT"}, ec);
+  if (ec == std::error_code{}) {
+    return {};
+  } else {
+    return ec;
+  }
+}
+
+namespace {
+
+// Set the in_progress and on_tape flags of the i-th file
+void read_xattrs(PhysicalPath const& path, std::size_t i, std::string& buffer,
+                 FileStatuses& result)
+{
+  using namespace std::string_view_literals;
+  constexpr auto in_progress_name = "user.TSMRecT"sv;
+  constexpr auto on_tape_name     = "user.storm.migrated"sv;
+
+  auto const size = list_xattrs(path, buffer);
+  if (size < 0) {
+    result.errors[i] = std::make_error_code(std::errc{errno});
+    return;
+  }
+
+  // the list is a sequence of null-terminated names
+  std::string_view names{buffer.data(), static_cast<std::size_t>(size)};
+  while (!names.empty()) {
+    auto const end  = names.find('\0');
+    auto const name = names.substr(0, end);
+    if (name == in_progress_name) {
+      result.in_progress[i] = true;
+    } else if (name == on_tape_name) {
+      result.on_tape[i] = true;
+    }
+    names.remove_prefix(end == std::string_view::npos ? names.size() : end + 1);
+  }
+}
+
+void sync_file_statuses(std::span<PhysicalPath const> paths,
+                        FileStatuses& result)
+{
+  constexpr auto bytes_per_block{512L};
+
+  // enough for the xattrs normally found on our files
+  std::string buffer(1024, '\0');
+
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    auto const& path = paths[i];
+
+    struct stat sb = {};
+    if (::stat(path.c_str(), &sb) == -1) {
+      result.errors[i] = std::make_error_code(std::errc{errno});
+      continue;
+    }
+    result.types[i]   = to_file_type(sb.st_mode);
+    result.sizes[i]   = static_cast<std::size_t>(sb.st_size);
+    result.is_stub[i] = sb.st_blocks * bytes_per_block < sb.st_size;
+
+    if (S_ISREG(sb.st_mode)) {
+      read_xattrs(path, i, buffer, result);
+    }
+  }
+}
+
+#ifdef STORM_IO_URING
+
+// set once io_uring turns out not to be usable, to avoid retrying on every
+// request
+std::atomic<bool> uring_unavailable{false};
+
+// Return the prober of the calling thread, creating it on first use; it stays
+// null if io_uring is not available
+std::unique_ptr<UringProber>& uring_prober()
+{
+  thread_local std::unique_ptr<UringProber> prober;
+  if (prober == nullptr && !uring_unavailable.load(std::memory_order_relaxed)) {
+    try {
+      prober = std::make_unique<UringProber>();
+    } catch (std::exception const& e) {
+      if (!uring_unavailable.exchange(true)) {
+        CROW_LOG_WARNING << fmt::format(
+            "io_uring is not available, falling back to stat: {}", e.what());
+      }
+    }
+  }
+  return prober;
+}
+
+bool uring_file_statuses(std::span<PhysicalPath const> paths,
+                         FileStatuses& result)
+{
+  auto& prober = uring_prober();
+  if (prober == nullptr) {
+    return false;
+  }
+
+  try {
+    prober->probe(paths, result);
+  } catch (std::exception const& e) {
+    CROW_LOG_WARNING << fmt::format("io_uring probe failed: {}", e.what());
+    // the rings may contain stale requests; start afresh next time
+    prober.reset();
+    return false;
+  }
+
+  if (!prober->has_getxattr()) {
+    std::string buffer(1024, '\0');
+    for (std::size_t i = 0; i != paths.size(); ++i) {
+      if (result.errors[i] == std::error_code{}
+          && result.types[i] == fs::file_type::regular) {
+        read_xattrs(paths[i], i, buffer, result);
+      }
+    }
+  }
+
+  return true;
+}
+
+#endif
+
+} // namespace
+
+FileStatuses LocalStorage::file_statuses(std::span<PhysicalPath const> paths)
+{
+  PROFILE_FUNCTION();
+  LatencyTimer const timer{Operation::storage_file_statuses};
+  FileStatuses result(paths.size());
+
+#ifdef STORM_IO_URING
+  if (uring_file_statuses(paths, result)) {
+    return result;
+  }
+  // a failed probe may have filled part of the result
+  result = FileStatuses(paths.size());
+#endif
+
+  sync_file_statuses(paths, result);
+  return result;
+}
+
 } // namespace storm
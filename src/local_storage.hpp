@@ -2,14 +2,21 @@
 #define STORM_LOCALSTORAGE_HPP
 
 #include "storage.hpp"
+#include <sys/types.h>
 
 namespace storm {
 
+fs::file_type to_file_type(mode_t mode);
+
 struct LocalStorage : Storage
 {
   Result<bool> is_in_progress(PhysicalPath const& path) override;
   Result<FileSizeInfo> file_size_info(PhysicalPath const& path) override;
   Result<bool> is_on_tape(PhysicalPath const& path) override;
+  // one stat and one listxattr for each file, or a few batches of statx and
+  // getxattr requests through io_uring if enabled
+  FileStatuses file_statuses(std::span<PhysicalPath const> paths) override;
+  Result<void> set_in_progress(PhysicalPath const& path) override;
 };
 
 } // namespace storm
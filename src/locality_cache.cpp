@@ -0,0 +1,122 @@
+#include "locality_cache.hpp"
+#include "profiler.hpp"
+#include <functional>
+
+namespace storm {
+
+LocalityCache::LocalityCache(std::size_t capacity, Clock::duration ttl)
+    : m_shard_capacity{(capacity + n_shards - 1) / n_shards}
+    , m_ttl{ttl}
+{}
+
+LocalityCache::Shard& LocalityCache::shard(std::string_view path)
+{
+  return m_shards[std::hash<std::string_view>{}(path) % n_shards];
+}
+
+std::optional<FileStatus> LocalityCache::find(PhysicalPath const& path)
+{
+  PROFILE_FUNCTION();
+  if (!enabled()) {
+    return std::nullopt;
+  }
+
+  auto const& key = path.native();
+  auto& s         = shard(key);
+  std::lock_guard lock{s.mutex};
+
+  auto const it = s.index.find(key);
+  if (it == s.index.end()) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+
+  auto const entry = it->second;
+  if (entry->expires_at <= Clock::now()) {
+    s.index.erase(it);
+    s.lru.erase(entry);
+    m_expirations.fetch_add(1, std::memory_order_relaxed);
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+
+  s.lru.splice(s.lru.begin(), s.lru, entry);
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return entry->status;
+}
+
+void LocalityCache::insert(PhysicalPath const& path, FileStatus const& status)
+{
+  PROFILE_FUNCTION();
+  if (!enabled()) {
+    return;
+  }
+
+  auto const& key       = path.native();
+  auto& s               = shard(key);
+  auto const expires_at = Clock::now() + m_ttl;
+  std::lock_guard lock{s.mutex};
+
+  if (auto const it = s.index.find(key); it != s.index.end()) {
+    auto const entry  = it->second;
+    entry->status     = status;
+    entry->expires_at = expires_at;
+    s.lru.splice(s.lru.begin(), s.lru, entry);
+    return;
+  }
+
+  if (s.lru.size() == m_shard_capacity) {
+    s.index.erase(s.lru.back().path);
+    s.lru.pop_back();
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  s.lru.push_front(Entry{key, status, expires_at});
+  s.index.emplace(s.lru.front().path, s.lru.begin());
+}
+
+void LocalityCache::invalidate(PhysicalPath const& path)
+{
+  PROFILE_FUNCTION();
+  if (!enabled()) {
+    return;
+  }
+
+  auto const& key = path.native();
+  auto& s         = shard(key);
+  std::lock_guard lock{s.mutex};
+
+  if (auto const it = s.index.find(key); it != s.index.end()) {
+    auto const entry = it->second;
+    s.index.erase(it);
+    s.lru.erase(entry);
+    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void LocalityCache::clear()
+{
+  for (auto& s : m_shards) {
+    std::lock_guard lock{s.mutex};
+    m_invalidations.fetch_add(s.lru.size(), std::memory_order_relaxed);
+    s.index.clear();
+    s.lru.clear();
+  }
+}
+
+LocalityCache::Stats LocalityCache::stats()
+{
+  Stats result;
+  result.hits          = m_hits.load(std::memory_order_relaxed);
+  result.misses        = m_misses.load(std::memory_order_relaxed);
+  result.evictions     = m_evictions.load(std::memory_order_relaxed);
+  result.expirations   = m_expirations.load(std::memory_order_relaxed);
+  result.invalidations = m_invalidations.load(std::memory_order_relaxed);
+  for (auto& s : m_shards) {
+    std::lock_guard lock{s.mutex};
+    result.size += s.lru.size();
+  }
+  return result;
+}
+
+} // namespace storm
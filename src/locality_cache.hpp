@@ -0,0 +1,90 @@
+#ifndef STORM_LOCALITY_CACHE_HPP
+#define STORM_LOCALITY_CACHE_HPP
+
+#include "storage.hpp"
+#include "types.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace storm {
+
+// Process-wide cache of the status of files on the storage, from which their
+// locality is derived.
+//
+// The cache is bounded and split in shards, each protected by its own mutex
+// and with its own LRU eviction. An entry expires after a fixed time-to-live,
+// so that changes done behind our back (e.g. by GEMSS) are eventually seen.
+// A capacity or a time-to-live of zero disables the cache.
+class LocalityCache
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats
+  {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t evictions{0};
+    std::uint64_t expirations{0};
+    std::uint64_t invalidations{0};
+    std::size_t size{0};
+  };
+
+ private:
+  static constexpr std::size_t n_shards{16};
+
+  struct Entry
+  {
+    std::string path;
+    FileStatus status;
+    Clock::time_point expires_at;
+  };
+
+  // the most recently used entry is at the front of the list; the keys of the
+  // map point to the paths stored in the list
+  struct Shard
+  {
+    std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+  };
+
+  std::size_t m_shard_capacity;
+  Clock::duration m_ttl;
+  std::array<Shard, n_shards> m_shards;
+
+  std::atomic<std::uint64_t> m_hits{0};
+  std::atomic<std::uint64_t> m_misses{0};
+  std::atomic<std::uint64_t> m_evictions{0};
+  std::atomic<std::uint64_t> m_expirations{0};
+  std::atomic<std::uint64_t> m_invalidations{0};
+
+  Shard& shard(std::string_view path);
+  bool enabled() const noexcept
+  {
+    return m_shard_capacity != 0 && m_ttl != Clock::duration::zero();
+  }
+
+ public:
+  LocalityCache(std::size_t capacity, Clock::duration ttl);
+  LocalityCache(LocalityCache const&)            = delete;
+  LocalityCache& operator=(LocalityCache const&) = delete;
+
+  std::optional<FileStatus> find(PhysicalPath const& path);
+  void insert(PhysicalPath const& path, FileStatus const& status);
+  void invalidate(PhysicalPath const& path);
+  void clear();
+  Stats stats();
+};
+
+} // namespace storm
+
+#endif // STORM_LOCALITY_CACHE_HPP
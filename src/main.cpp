@@ -1,16 +1,22 @@
+#include "access_log_writer.hpp"
 #include "app.hpp"
 #include "configuration.hpp"
 #include "database.hpp"
+#include "database_cache.hpp"
 #include "database_soci.hpp"
 #include "errors.hpp"
 #include "local_storage.hpp"
+#include "locality_cache.hpp"
 #include "profiler.hpp"
+#include "reconciler.hpp"
 #include "routes.hpp"
+#include "storage_cache.hpp"
 #include "tape_service.hpp"
 #include <boost/program_options.hpp>
 #include <crow.h>
 #include <fmt/core.h>
-#include <soci/sqlite3/soci-sqlite3.h>
+#include <chrono>
+#include <csignal>
 #include <filesystem>
 
 namespace po = boost::program_options;
@@ -43,19 +49,42 @@ int main(int argc, char* argv[])
 
     auto const config = storm::load_configuration(fs::path{config_file});
 
+#ifdef PROFILING
+    storm::Instrumentor::enable(config.profiling.enabled);
+    storm::Instrumentor::set_sampling(config.profiling.sampling);
+    // start the writer before a signal can arrive
+    storm::Instrumentor::Instance();
+    std::signal(SIGUSR1, [](int) { storm::Instrumentor::toggle(); });
+#endif
+
+    storm::AccessLogWriter access_log{config.access_log.path,
+                                      config.access_log.buffer_size};
+    std::signal(SIGHUP, [](int) { storm::AccessLogWriter::request_reopen(); });
+
     storm::CrowApp app;
     app.loglevel(crow::LogLevel{config.log_level});
-    soci::session sql(soci::sqlite3, "storm-tape.sqlite");
-    storm::SociDatabase db{sql};
+    app.get_middleware<storm::AccessLogger>().writer = &access_log;
+    auto const pool =
+        storm::make_sqlite_pool(config.concurrency, config.database);
+    storm::SociDatabase soci_db{*pool};
+    storm::CachingDatabase db{soci_db};
     // storm::MockDatabase db{};
-    storm::LocalStorage storage{};
+    storm::LocalStorage local_storage{};
+    storm::LocalityCache locality_cache{
+        config.locality_cache.capacity,
+        std::chrono::seconds{config.locality_cache.ttl}};
+    storm::CachingStorage storage{local_storage, locality_cache,
+                                  config.locality_cache.inotify};
     storm::TapeService service{config, db, storage};
+    storm::Reconciler reconciler{
+        service, std::chrono::seconds{config.reconciler.interval}};
 
     storm::create_routes(app, config, service);
     storm::create_internal_routes(app, config, service);
+    storm::create_metrics_routes(app, locality_cache);
 
     // TODO add signals?
-    app.port(config.port).concurrency(1).run();
+    app.port(config.port).concurrency(config.concurrency).run();
   } catch (std::exception const& e) {
     CROW_LOG_CRITICAL << fmt::format("Caught exception: {}", e.what());
     return EXIT_FAILURE;
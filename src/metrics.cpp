@@ -0,0 +1,195 @@
+#include "metrics.hpp"
+#include <fmt/core.h>
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+
+namespace storm {
+
+namespace {
+
+struct Family
+{
+  std::string_view name;
+  std::string_view label;
+  std::string_view help;
+};
+
+constexpr Family request_family{"storm_tape_request_duration_seconds",
+                                "operation", "Time to serve an HTTP request"};
+constexpr Family database_family{"storm_tape_database_duration_seconds",
+                                 "method", "Time spent in a database method"};
+constexpr Family storage_family{"storm_tape_storage_duration_seconds", "call",
+                                "Time spent in a call to the storage"};
+
+struct OperationInfo
+{
+  Family const* family;
+  std::string_view label;
+};
+
+// indexed by Operation; the operations of a family are contiguous
+constexpr std::array<OperationInfo, n_operations> operations{{
+    {&request_family, "STAGE"},
+    {&request_family, "STATUS"},
+    {&request_family, "CANCEL"},
+    {&request_family, "DELETE"},
+    {&request_family, "RELEASE"},
+    {&request_family, "ARCHIVEINFO"},
+    {&request_family, "READY"},
+    {&request_family, "TAKE_OVER"},
+    {&request_family, "IN_PROGRESS"},
+    {&database_family, "insert"},
+    {&database_family, "find"},
+    {&database_family, "find_incomplete_stages"},
+    {&database_family, "update_logical_path"},
+    {&database_family, "update_logical_paths"},
+    {&database_family, "update_physical_path"},
+    {&database_family, "update_physical_paths"},
+    {&database_family, "update_path_states"},
+    {&database_family, "update_stage_entity"},
+    {&database_family, "update_stage"},
+    {&database_family, "erase"},
+    {&database_family, "count_files"},
+    {&database_family, "get_files"},
+    {&database_family, "find_files_in_progress"},
+    {&storage_family, "is_in_progress"},
+    {&storage_family, "file_size_info"},
+    {&storage_family, "is_on_tape"},
+    {&storage_family, "file_statuses"},
+    {&storage_family, "set_in_progress"},
+}};
+
+constexpr std::size_t index(Operation op)
+{
+  return static_cast<std::size_t>(op);
+}
+
+double to_seconds(std::uint64_t ns)
+{
+  return static_cast<double>(ns) / 1e9;
+}
+
+} // namespace
+
+std::uint64_t Metrics::Histogram::count() const noexcept
+{
+  return std::accumulate(counts.begin(), counts.end(), std::uint64_t{0});
+}
+
+Metrics& Metrics::instance()
+{
+  static Metrics instance;
+  return instance;
+}
+
+Metrics::Slot& Metrics::acquire()
+{
+  std::lock_guard lock{m_mutex};
+  if (!m_free_slots.empty()) {
+    auto const slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return *slot;
+  }
+  return m_slots.emplace_back();
+}
+
+void Metrics::release(Slot& slot)
+{
+  std::lock_guard lock{m_mutex};
+  m_free_slots.push_back(&slot);
+}
+
+Metrics::Slot& Metrics::slot()
+{
+  // give the slot back when the thread exits
+  struct Holder
+  {
+    Slot* slot{nullptr};
+    ~Holder()
+    {
+      if (slot != nullptr) {
+        Metrics::instance().release(*slot);
+      }
+    }
+  };
+  thread_local Holder holder;
+
+  if (holder.slot == nullptr) {
+    holder.slot = &acquire();
+  }
+  return *holder.slot;
+}
+
+void Metrics::record(Operation op, std::chrono::nanoseconds duration)
+{
+  auto const ns     = std::max(duration, std::chrono::nanoseconds::zero());
+  auto const bucket = static_cast<std::size_t>(
+      std::lower_bound(bucket_bounds.begin(), bucket_bounds.end(), ns)
+      - bucket_bounds.begin());
+
+  auto& histogram = slot().histograms[index(op)];
+  histogram.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  histogram.sum_ns.fetch_add(static_cast<std::uint64_t>(ns.count()),
+                             std::memory_order_relaxed);
+}
+
+Metrics::Histogram Metrics::histogram(Operation op) const
+{
+  Histogram result;
+  std::lock_guard lock{m_mutex};
+  for (auto const& slot : m_slots) {
+    auto const& h = slot.histograms[index(op)];
+    for (std::size_t b = 0; b != n_buckets; ++b) {
+      result.counts[b] += h.counts[b].load(std::memory_order_relaxed);
+    }
+    result.sum_ns += h.sum_ns.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+std::string Metrics::to_prometheus() const
+{
+  std::string result;
+  Family const* family = nullptr;
+
+  for (std::size_t i = 0; i != n_operations; ++i) {
+    auto const& info = operations[i];
+    if (info.family != family) {
+      family = info.family;
+      fmt::format_to(std::back_inserter(result),
+                     "# HELP {0} {1}\n# TYPE {0} histogram\n", family->name,
+                     family->help);
+    }
+
+    auto const h = histogram(static_cast<Operation>(i));
+    std::uint64_t cumulative{0};
+    for (std::size_t b = 0; b != bucket_bounds.size(); ++b) {
+      cumulative += h.counts[b];
+      fmt::format_to(
+          std::back_inserter(result), "{}_bucket{{{}=\"{}\",le=\"{}\"}} {}\n",
+          family->name, family->label, info.label,
+          std::chrono::duration<double>{bucket_bounds[b]}.count(),
+          cumulative);
+    }
+    cumulative += h.counts.back();
+    fmt::format_to(std::back_inserter(result),
+                   "{0}_bucket{{{1}=\"{2}\",le=\"+Inf\"}} {3}\n"
+                   "{0}_sum{{{1}=\"{2}\"}} {4}\n"
+                   "{0}_count{{{1}=\"{2}\"}} {3}\n",
+                   family->name, family->label, info.label, cumulative,
+                   to_seconds(h.sum_ns));
+  }
+
+  return result;
+}
+
+LatencyTimer::~LatencyTimer()
+{
+  try {
+    Metrics::instance().record(m_op, Clock::now() - m_start);
+  } catch (...) {
+  }
+}
+
+} // namespace storm
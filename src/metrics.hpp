@@ -0,0 +1,139 @@
+#ifndef STORM_METRICS_HPP
+#define STORM_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace storm {
+
+// The operations whose latency is measured
+enum class Operation : std::uint8_t
+{
+  // HTTP requests
+  stage,
+  status,
+  cancel,
+  erase,
+  release,
+  archive_info,
+  ready_take_over,
+  take_over,
+  in_progress,
+  // SociDatabase methods
+  db_insert,
+  db_find,
+  db_find_incomplete_stages,
+  db_update_logical_path,
+  db_update_logical_paths,
+  db_update_physical_path,
+  db_update_physical_paths,
+  db_update_path_states,
+  db_update_stage_entity,
+  db_update_stage,
+  db_erase,
+  db_count_files,
+  db_get_files,
+  db_find_files_in_progress,
+  // LocalStorage calls
+  storage_is_in_progress,
+  storage_file_size_info,
+  storage_is_on_tape,
+  storage_file_statuses,
+  storage_set_in_progress,
+};
+
+inline constexpr std::size_t n_operations =
+    static_cast<std::size_t>(Operation::storage_set_in_progress) + 1;
+
+// Always-on latency histograms, one per Operation, with fixed buckets.
+//
+// Each thread records into its own slot of counters, with relaxed atomic
+// increments that never contend with other threads; the slots are summed up
+// only when the metrics are read. When a thread exits its slot is reused, with
+// its counts, by the next thread that records something, so the number of
+// slots is bounded by the number of threads alive at the same time.
+class Metrics
+{
+ public:
+  // upper bounds of the buckets, the last bucket is unbounded
+  static constexpr std::array<std::chrono::nanoseconds, 16> bucket_bounds{
+      std::chrono::microseconds{100}, std::chrono::microseconds{250},
+      std::chrono::microseconds{500}, std::chrono::milliseconds{1},
+      std::chrono::microseconds{2'500}, std::chrono::milliseconds{5},
+      std::chrono::milliseconds{10},  std::chrono::milliseconds{25},
+      std::chrono::milliseconds{50},  std::chrono::milliseconds{100},
+      std::chrono::milliseconds{250}, std::chrono::milliseconds{500},
+      std::chrono::seconds{1},        std::chrono::milliseconds{2'500},
+      std::chrono::seconds{5},        std::chrono::seconds{10}};
+  static constexpr std::size_t n_buckets = bucket_bounds.size() + 1;
+
+  struct Histogram
+  {
+    // not cumulative
+    std::array<std::uint64_t, n_buckets> counts{};
+    std::uint64_t sum_ns{0};
+
+    std::uint64_t count() const noexcept;
+  };
+
+ private:
+  struct AtomicHistogram
+  {
+    std::array<std::atomic<std::uint64_t>, n_buckets> counts{};
+    std::atomic<std::uint64_t> sum_ns{0};
+  };
+
+  // aligned so that the slots of different threads do not share cache lines
+  struct alignas(64) Slot
+  {
+    std::array<AtomicHistogram, n_operations> histograms{};
+  };
+
+  mutable std::mutex m_mutex;
+  // the elements of a deque do not move
+  std::deque<Slot> m_slots;
+  std::vector<Slot*> m_free_slots;
+
+  Metrics() = default;
+  Slot& acquire();
+  void release(Slot& slot);
+  Slot& slot();
+
+ public:
+  static Metrics& instance();
+  Metrics(Metrics const&)            = delete;
+  Metrics& operator=(Metrics const&) = delete;
+
+  void record(Operation op, std::chrono::nanoseconds duration);
+  Histogram histogram(Operation op) const;
+  // Prometheus text exposition format
+  std::string to_prometheus() const;
+};
+
+// Record the time spent in a scope
+class LatencyTimer
+{
+  using Clock = std::chrono::steady_clock;
+
+  Operation m_op;
+  Clock::time_point m_start{Clock::now()};
+
+ public:
+  explicit LatencyTimer(Operation op) noexcept
+      : m_op{op}
+  {}
+  ~LatencyTimer();
+  LatencyTimer(LatencyTimer const&)            = delete;
+  LatencyTimer& operator=(LatencyTimer const&) = delete;
+};
+
+} // namespace storm
+
+#endif // STORM_METRICS_HPP
@@ -0,0 +1,76 @@
+#include "path_table.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace storm {
+
+std::string PathParts::str() const
+{
+  std::string result;
+  result.reserve(size());
+  result.append(prefix);
+  result.append(tail);
+  return result;
+}
+
+int compare(PathParts const& parts, std::string_view s) noexcept
+{
+  auto const head = s.substr(0, parts.prefix.size());
+  if (auto const c = parts.prefix.compare(head); c != 0) {
+    return c;
+  }
+  return parts.tail.compare(s.substr(head.size()));
+}
+
+std::uint32_t PathTable::intern(std::string_view prefix)
+{
+  if (auto const it = m_prefix_index.find(prefix); it != m_prefix_index.end()) {
+    return it->second;
+  }
+  auto const i = static_cast<std::uint32_t>(m_prefixes.size());
+  m_prefixes.emplace_back(prefix);
+  m_prefix_index.emplace(m_prefixes.back(), i);
+  return i;
+}
+
+void PathTable::reserve(std::size_t n_paths, std::size_t n_bytes)
+{
+  m_entries.reserve(n_paths);
+  m_buffer.reserve(n_bytes);
+}
+
+PathTable::Index PathTable::add(std::string_view logical,
+                                std::string_view physical)
+{
+  constexpr std::size_t max_size{std::numeric_limits<std::uint32_t>::max()};
+  if (m_entries.size() == max_size
+      || physical.size() > max_size - m_buffer.size()) {
+    throw std::length_error("too many paths in a PathTable");
+  }
+
+  // the longest common tail, starting at a separator so that files in the
+  // same storage area share the prefix of the logical path
+  auto const max_tail = std::min(logical.size(), physical.size());
+  std::size_t n{0};
+  while (n != max_tail
+         && logical[logical.size() - 1 - n]
+                == physical[physical.size() - 1 - n]) {
+    ++n;
+  }
+  auto tail = physical.size() - n;
+  if (tail != 0) {
+    tail = std::min(physical.find('/', tail), physical.size());
+  }
+  auto const prefix =
+      logical.substr(0, logical.size() - (physical.size() - tail));
+
+  auto const i = static_cast<Index>(m_entries.size());
+  m_entries.push_back(Entry{static_cast<std::uint32_t>(m_buffer.size()),
+                            static_cast<std::uint32_t>(physical.size()),
+                            static_cast<std::uint32_t>(tail), intern(prefix)});
+  m_buffer.append(physical);
+  return i;
+}
+
+} // namespace storm
@@ -0,0 +1,95 @@
+#ifndef STORM_PATH_TABLE_HPP
+#define STORM_PATH_TABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace storm {
+
+// A path stored in two pieces, e.g. a shared prefix and a tail
+struct PathParts
+{
+  std::string_view prefix;
+  std::string_view tail;
+
+  std::size_t size() const noexcept
+  {
+    return prefix.size() + tail.size();
+  }
+  std::string str() const;
+};
+
+// Compare the concatenation of the parts with a string, with the same result
+// as std::string_view::compare
+int compare(PathParts const& parts, std::string_view s) noexcept;
+
+// Compact storage for the logical and physical paths of many files.
+//
+// The physical paths are stored back to back in a single buffer. A logical
+// path and the corresponding physical path usually differ only in the root of
+// their storage area, hence the logical path is represented as a prefix,
+// stored once for all the files that share it, followed by the tail of the
+// physical path. The paths are referenced by their index in the table; the
+// views returned for them are invalidated by the next add().
+class PathTable
+{
+ public:
+  using Index = std::uint32_t;
+
+ private:
+  struct Entry
+  {
+    // offset in the buffer and size of the physical path
+    std::uint32_t offset;
+    std::uint32_t size;
+    // offset within the physical path of the tail shared with the logical path
+    std::uint32_t tail;
+    // index of the prefix of the logical path
+    std::uint32_t prefix;
+  };
+
+  std::string m_buffer;
+  std::vector<Entry> m_entries;
+  // the elements of a deque do not move, so the map keys can point to them
+  std::deque<std::string> m_prefixes;
+  std::unordered_map<std::string_view, std::uint32_t> m_prefix_index;
+
+  std::uint32_t intern(std::string_view prefix);
+
+ public:
+  PathTable()                            = default;
+  PathTable(PathTable const&)            = delete;
+  PathTable& operator=(PathTable const&) = delete;
+  PathTable(PathTable&&)                 = default;
+  PathTable& operator=(PathTable&&)      = default;
+
+  void reserve(std::size_t n_paths, std::size_t n_bytes);
+  Index add(std::string_view logical, std::string_view physical);
+
+  std::size_t size() const noexcept
+  {
+    return m_entries.size();
+  }
+  bool empty() const noexcept
+  {
+    return m_entries.empty();
+  }
+  std::string_view physical(Index i) const noexcept
+  {
+    auto const& e = m_entries[i];
+    return std::string_view{m_buffer}.substr(e.offset, e.size);
+  }
+  PathParts logical(Index i) const noexcept
+  {
+    auto const& e = m_entries[i];
+    return PathParts{m_prefixes[e.prefix], physical(i).substr(e.tail)};
+  }
+};
+
+} // namespace storm
+
+#endif // STORM_PATH_TABLE_HPP
@@ -1,19 +1,155 @@
 #include "profiler.hpp"
 #include <fmt/core.h>
+#include <algorithm>
+#include <functional>
+#include <string>
 
 namespace storm {
 
-void Instrumentor::write_profile(const ProfileResult& result)
+bool ProfileBuffer::push(ProfileResult const& result) noexcept
+{
+  auto const tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_head.load(std::memory_order_acquire) == capacity) {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  m_results[tail % capacity] = result;
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+std::size_t ProfileBuffer::drain(std::vector<ProfileResult>& out)
 {
-  std::lock_guard lock(m_lock);
+  auto const head = m_head.load(std::memory_order_relaxed);
+  auto const tail = m_tail.load(std::memory_order_acquire);
+  for (auto i = head; i != tail; ++i) {
+    out.push_back(m_results[i % capacity]);
+  }
+  m_head.store(tail, std::memory_order_release);
+  return tail - head;
+}
 
+std::uint64_t ProfileBuffer::take_dropped() noexcept
+{
+  return m_dropped.exchange(0, std::memory_order_relaxed);
+}
+
+Instrumentor::Instrumentor()
+{
+  write_header();
+  m_writer = std::thread{[this] { run(); }};
+}
+
+Instrumentor::~Instrumentor()
+{
+  {
+    std::lock_guard lock{m_lock};
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  m_writer.join();
+  flush();
+  write_footer();
+}
+
+void Instrumentor::run()
+{
+  using namespace std::chrono_literals;
+  std::unique_lock lock{m_lock};
+  while (!m_cv.wait_for(lock, 100ms, [this] { return m_stop; })) {
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+
+// Drain the buffers of all the threads and write their results. Only the
+// writer thread, or the destructor after it has stopped, calls it.
+void Instrumentor::flush()
+{
+  std::vector<ProfileResult> results;
+  std::uint64_t n_dropped{0};
+  {
+    std::lock_guard lock{m_lock};
+    for (auto& buffer : m_buffers) {
+      buffer.drain(results);
+      n_dropped += buffer.take_dropped();
+    }
+  }
+
+  for (auto const& result : results) {
+    write_profile(result);
+  }
+  if (n_dropped != 0) {
+    auto const now = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+    write_dropped(n_dropped, now);
+  }
+  m_os.flush();
+}
+
+ProfileBuffer& Instrumentor::acquire()
+{
+  std::lock_guard lock{m_lock};
+  ProfileBuffer* buffer;
+  if (m_free_buffers.empty()) {
+    buffer = &m_buffers.emplace_back();
+  } else {
+    buffer = m_free_buffers.back();
+    m_free_buffers.pop_back();
+  }
+  buffer->thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  buffer->n_skipped = 0;
+  return *buffer;
+}
+
+void Instrumentor::release(ProfileBuffer& buffer)
+{
+  // the results still queued are drained by the writer as usual
+  std::lock_guard lock{m_lock};
+  m_free_buffers.push_back(&buffer);
+}
+
+ProfileBuffer* Instrumentor::sample()
+{
+  if (!enabled()) {
+    return nullptr;
+  }
+
+  // give the buffer back when the thread exits
+  struct Holder
+  {
+    ProfileBuffer* buffer{nullptr};
+    ~Holder()
+    {
+      if (buffer != nullptr) {
+        Instrumentor::Instance().release(*buffer);
+      }
+    }
+  };
+  thread_local Holder holder;
+
+  if (holder.buffer == nullptr) {
+    holder.buffer = &acquire();
+  }
+  auto& buffer = *holder.buffer;
+  if (++buffer.n_skipped < s_sampling.load(std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  buffer.n_skipped = 0;
+  return &buffer;
+}
+
+void Instrumentor::write_profile(const ProfileResult& result)
+{
   if (m_first_profile) {
     m_first_profile = false;
   } else {
     m_os << ',';
   }
 
-  auto name = result.name;
+  std::string name{result.name};
   std::replace(name.begin(), name.end(), '"', '\'');
   m_os << fmt::format(
       R"({{"cat":"function","dur":{},"name":"{}","ph":"X","pid":0,"tid":{},"ts":{}}})",
@@ -21,4 +157,19 @@ void Instrumentor::write_profile(const ProfileResult& result)
        << '\n';
 }
 
+// a counter event, so that the losses are visible in the trace
+void Instrumentor::write_dropped(std::uint64_t n_dropped, long long ts)
+{
+  if (m_first_profile) {
+    m_first_profile = false;
+  } else {
+    m_os << ',';
+  }
+
+  m_os << fmt::format(
+      R"({{"name":"dropped","ph":"C","pid":0,"ts":{},"args":{{"results":{}}}}})",
+      ts, n_dropped)
+       << '\n';
+}
+
 } // namespace storm
@@ -1,12 +1,17 @@
 #ifndef PROFILER_HPP
 #define PROFILER_HPP
 
-#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <fstream>
 #include <mutex>
-#include <string>
 #include <thread>
+#include <vector>
 
 #ifdef PROFILING
 #  define COMBINE_HELPER(X,Y) X##Y
@@ -22,22 +27,64 @@ namespace storm {
 
 struct ProfileResult
 {
-  std::string name;
+  // a string literal or __PRETTY_FUNCTION__, whose lifetime is the program's
+  char const* name;
   long long start;
   long long end;
   std::size_t thread_id;
 };
 
+// Bounded single-producer single-consumer queue of profile results. The
+// producer is the thread being profiled, the consumer is the writer of the
+// Instrumentor. When the queue is full the results are dropped and counted.
+class ProfileBuffer
+{
+ public:
+  static constexpr std::size_t capacity{4096};
+
+ private:
+  std::array<ProfileResult, capacity> m_results;
+  // written by the consumer
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  // written by the producer
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+  std::atomic<std::uint64_t> m_dropped{0};
+
+ public:
+  // used only by the producer
+  std::size_t thread_id{0};
+  std::uint32_t n_skipped{0};
+
+  bool push(ProfileResult const& result) noexcept;
+  // append the queued results to out and return how many they were
+  std::size_t drain(std::vector<ProfileResult>& out);
+  // return the number of results dropped since the previous call
+  std::uint64_t take_dropped() noexcept;
+};
+
+// Collect the profile results of all the threads and write them to
+// results.json, in the Chrome trace format, from a background thread.
+//
+// Each thread queues its results in its own ProfileBuffer, without locks or
+// formatting on the profiled path; the writer drains the buffers periodically.
+// Tracing can be switched on and off at runtime, e.g. from a signal handler,
+// and only one scope every "sampling" is recorded.
 class Instrumentor
 {
+  static inline std::atomic<bool> s_enabled{true};
+  static inline std::atomic<std::uint32_t> s_sampling{1};
+
   std::ofstream m_os{"results.json"};
   bool m_first_profile{true};
   std::mutex m_lock;
+  std::condition_variable m_cv;
+  bool m_stop{false};
+  // the elements of a deque do not move
+  std::deque<ProfileBuffer> m_buffers;
+  std::vector<ProfileBuffer*> m_free_buffers;
+  std::thread m_writer;
 
-  Instrumentor()
-  {
-    write_header();
-  }
+  Instrumentor();
 
   void write_header()
   {
@@ -49,6 +96,13 @@ class Instrumentor
     m_os << "]}";
   }
 
+  void run();
+  void flush();
+  ProfileBuffer& acquire();
+  void release(ProfileBuffer& buffer);
+  void write_profile(const ProfileResult& result);
+  void write_dropped(std::uint64_t n_dropped, long long ts);
+
  public:
   static Instrumentor& Instance()
   {
@@ -56,12 +110,30 @@ class Instrumentor
     return instance;
   }
 
-  ~Instrumentor()
+  ~Instrumentor();
+
+  // lock-free, hence safe to call from a signal handler
+  static void enable(bool on) noexcept
+  {
+    s_enabled.store(on, std::memory_order_relaxed);
+  }
+  static void toggle() noexcept
+  {
+    s_enabled.store(!s_enabled.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  }
+  static bool enabled() noexcept
+  {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+  // record one scope every n
+  static void set_sampling(std::uint32_t n) noexcept
   {
-    write_footer();
+    s_sampling.store(n == 0 ? 1 : n, std::memory_order_relaxed);
   }
 
-  void write_profile(const ProfileResult& result);
+  // the buffer of the calling thread, if the next scope has to be recorded
+  ProfileBuffer* sample();
 };
 
 class InstrumentationTimer
@@ -69,35 +141,34 @@ class InstrumentationTimer
   using Clock     = std::chrono::steady_clock;
   using TimePoint = std::chrono::time_point<Clock>;
 
-  std::string m_name;
-  TimePoint m_start_tp = Clock::now();
+  char const* m_name;
+  ProfileBuffer* m_buffer;
+  TimePoint m_start_tp;
 
-  void stop()
+  static long long to_us(TimePoint tp)
   {
-    auto const start = std::chrono::duration_cast<std::chrono::microseconds>(
-                           m_start_tp.time_since_epoch())
-                           .count();
-    auto const end = std::chrono::duration_cast<std::chrono::microseconds>(
-                         Clock::now().time_since_epoch())
-                         .count();
-    auto const thread_id =
-        std::hash<std::thread::id>{}(std::this_thread::get_id());
-
-    Instrumentor::Instance().write_profile({m_name, start, end, thread_id});
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               tp.time_since_epoch())
+        .count();
   }
 
  public:
-  InstrumentationTimer(std::string name)
-      : m_name{std::move(name)}
+  InstrumentationTimer(char const* name)
+      : m_name{name}
+      , m_buffer{Instrumentor::Instance().sample()}
+      , m_start_tp{m_buffer != nullptr ? Clock::now() : TimePoint{}}
   {}
 
   ~InstrumentationTimer()
   {
-    try {
-      stop();
-    } catch (...) {
+    if (m_buffer != nullptr) {
+      m_buffer->push({m_name, to_us(m_start_tp), to_us(Clock::now()),
+                      m_buffer->thread_id});
     }
   }
+
+  InstrumentationTimer(InstrumentationTimer const&)            = delete;
+  InstrumentationTimer& operator=(InstrumentationTimer const&) = delete;
 };
 
 } // namespace storm
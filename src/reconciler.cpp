@@ -0,0 +1,43 @@
+#include "reconciler.hpp"
+#include "tape_service.hpp"
+#include <crow/logging.h>
+#include <fmt/core.h>
+#include <exception>
+
+namespace storm {
+
+Reconciler::Reconciler(TapeService& service, std::chrono::seconds interval)
+    : m_service{service}
+    , m_interval{interval}
+{
+  m_thread = std::jthread{[this] { run(); }};
+}
+
+Reconciler::~Reconciler()
+{
+  {
+    std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  // the thread is joined by the jthread destructor
+}
+
+void Reconciler::run()
+{
+  for (;;) {
+    try {
+      m_service.reconcile();
+    } catch (std::exception const& e) {
+      // try again at the next pass
+      CROW_LOG_ERROR << fmt::format("Reconciliation failed: {}", e.what());
+    }
+
+    std::unique_lock lock{m_mutex};
+    if (m_cv.wait_for(lock, m_interval, [this] { return m_stop; })) {
+      return;
+    }
+  }
+}
+
+} // namespace storm
@@ -0,0 +1,38 @@
+#ifndef STORM_RECONCILER_HPP
+#define STORM_RECONCILER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace storm {
+
+class TapeService;
+
+// Periodically reconcile the state of the files in the database with the
+// storage, in a background thread, so that the cost of probing the storage is
+// not paid by the clients asking for the status of a stage and the rate of the
+// probes is bounded. A first pass is done as soon as the thread starts, since
+// the database may be stale after a restart.
+class Reconciler
+{
+  TapeService& m_service;
+  std::chrono::seconds m_interval;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stop{false};
+  std::jthread m_thread;
+
+  void run();
+
+ public:
+  Reconciler(TapeService& service, std::chrono::seconds interval);
+  ~Reconciler();
+  Reconciler(Reconciler const&)            = delete;
+  Reconciler& operator=(Reconciler const&) = delete;
+};
+
+} // namespace storm
+
+#endif // STORM_RECONCILER_HPP
@@ -6,6 +6,8 @@
 #include "delete_response.hpp"
 #include "errors.hpp"
 #include "io.hpp"
+#include "locality_cache.hpp"
+#include "metrics.hpp"
 #include "profiler.hpp"
 #include "readytakeover_response.hpp"
 #include "release_response.hpp"
@@ -28,11 +30,13 @@ void create_routes(CrowApp& app, Configuration const& config,
   CROW_ROUTE(app, "/api/v1/stage")
       .methods("POST"_method)([&](crow::request const& req) {
         PROFILE_SCOPE("STAGE");
+        LatencyTimer const timer{Operation::stage};
         auto& access_logger = app.get_context<AccessLogger>(req);
         access_logger.operation = "STAGE";
         try {
-          StageRequest request{from_json(req.body, StageRequest::tag),
-                               std::time(nullptr), 0, 0};
+          StageRequest request{
+              from_json(req.body, StageRequest::tag, config.limits),
+              std::time(nullptr), 0, 0};
           auto resp      = service.stage(std::move(request));
           auto crow_resp = to_crow_response(resp, get_hostinfo(req, config));
           access_logger.stage_id = resp.id();
@@ -53,6 +57,7 @@ void create_routes(CrowApp& app, Configuration const& config,
   CROW_ROUTE(app, "/api/v1/stage/<string>")
   ([&](crow::request const& req, std::string const& id) {
     PROFILE_SCOPE("STATUS");
+    LatencyTimer const timer{Operation::status};
     app.get_context<AccessLogger>(req).operation = "STATUS";
     app.get_context<AccessLogger>(req).stage_id  = id;
     try {
@@ -74,10 +79,12 @@ void create_routes(CrowApp& app, Configuration const& config,
       .methods("POST"_method)(
           [&](crow::request const& req, std::string const& id) {
             PROFILE_SCOPE("CANCEL");
+            LatencyTimer const timer{Operation::cancel};
             app.get_context<AccessLogger>(req).operation = "CANCEL";
             app.get_context<AccessLogger>(req).stage_id  = id;
             try {
-              CancelRequest cancel{from_json(req.body, CancelRequest::tag)};
+              CancelRequest cancel{
+                  from_json(req.body, CancelRequest::tag, config.limits)};
               auto resp = service.cancel(StageId{id}, std::move(cancel));
               if (resp.invalid.empty()) {
                 return crow::response{crow::status::OK};
@@ -99,6 +106,7 @@ void create_routes(CrowApp& app, Configuration const& config,
       .methods("DELETE"_method)(
           [&](crow::request const& req, std::string const& id) {
             PROFILE_SCOPE("DELETE");
+            LatencyTimer const timer{Operation::erase};
             app.get_context<AccessLogger>(req).operation = "DELETE";
             app.get_context<AccessLogger>(req).stage_id  = id;
             try {
@@ -120,10 +128,12 @@ void create_routes(CrowApp& app, Configuration const& config,
       .methods("POST"_method)(
           [&](crow::request const& req, std::string const& id) {
             PROFILE_SCOPE("RELEASE");
+            LatencyTimer const timer{Operation::release};
             app.get_context<AccessLogger>(req).operation = "RELEASE";
             app.get_context<AccessLogger>(req).stage_id  = id;
             try {
-              ReleaseRequest release{from_json(req.body, ReleaseRequest::tag)};
+              ReleaseRequest release{
+                  from_json(req.body, ReleaseRequest::tag, config.limits)};
               auto resp = service.release(StageId{id}, std::move(release));
               if (resp.invalid.empty()) {
                 return crow::response{crow::status::OK};
@@ -144,9 +154,11 @@ void create_routes(CrowApp& app, Configuration const& config,
   CROW_ROUTE(app, "/api/v1/archiveinfo")
       .methods("POST"_method)([&](crow::request const& req) {
         PROFILE_SCOPE("ARCHIVEINFO");
+        LatencyTimer const timer{Operation::archive_info};
         app.get_context<AccessLogger>(req).operation = "ARCHIVEINFO";
         try {
-          ArchiveInfoRequest info{from_json(req.body, ArchiveInfoRequest::tag)};
+          ArchiveInfoRequest info{
+              from_json(req.body, ArchiveInfoRequest::tag, config.limits)};
           auto const resp = service.archive_info(std::move(info));
           return to_crow_response(resp);
         } catch (HttpError const& e) {
@@ -171,6 +183,7 @@ void create_internal_routes(CrowApp& app, storm::Configuration const&,
   CROW_ROUTE(app, "/recalltable/cardinality/tasks/readyTakeOver")
   ([&](crow::request const& req) {
     PROFILE_SCOPE("READY");
+    LatencyTimer const timer{Operation::ready_take_over};
     app.get_context<AccessLogger>(req).operation = "READY";
     try {
       auto const resp = service.ready_take_over();
@@ -187,6 +200,7 @@ void create_internal_routes(CrowApp& app, storm::Configuration const&,
   CROW_ROUTE(app, "/recalltable/tasks")
       .methods("PUT"_method)([&](crow::request const& req) {
         PROFILE_SCOPE("TAKE_OVER");
+        LatencyTimer const timer{Operation::take_over};
         app.get_context<AccessLogger>(req).operation = "TAKE_OVER";
         try {
           TakeOverRequest const take_over{
@@ -208,6 +222,7 @@ void create_internal_routes(CrowApp& app, storm::Configuration const&,
   CROW_ROUTE(app, "/recalltable/in_progress")
   ([&](crow::request const& req) {
     PROFILE_SCOPE("IN_PROGRESS");
+    LatencyTimer const timer{Operation::in_progress};
     app.get_context<AccessLogger>(req).operation = "IN_PROGRESS";
     try {
       auto in_progress = from_query_params(req.url_params, InProgressRequest::tag);
@@ -226,4 +241,13 @@ void create_internal_routes(CrowApp& app, storm::Configuration const&,
   });
 }
 
+void create_metrics_routes(CrowApp& app, LocalityCache& locality_cache)
+{
+  CROW_ROUTE(app, "/metrics")
+  ([&](crow::request const& req) {
+    app.get_context<AccessLogger>(req).operation = "METRICS";
+    return to_crow_response(Metrics::instance(), locality_cache.stats());
+  });
+}
+
 } // namespace storm
\ No newline at end of file
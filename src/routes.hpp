@@ -8,12 +8,14 @@ namespace storm {
 class Configuration;
 class Database;
 class TapeService;
+class LocalityCache;
 
 void create_routes(CrowApp& app, storm::Configuration const& config,
                    storm::TapeService& service);
 void create_internal_routes(CrowApp& app,
                             storm::Configuration const& config,
                             storm::TapeService& service);
+void create_metrics_routes(CrowApp& app, storm::LocalityCache& locality_cache);
 } // namespace storm
 
 #endif
@@ -1,6 +1,9 @@
 #ifndef STORM_TAPE_SQL_QUERIES_H
 #define STORM_TAPE_SQL_QUERIES_H
 
+#include <array>
+#include <span>
+
 namespace storm::sql {
 // ---------------------
 // Stage Table
@@ -73,6 +76,204 @@ static constexpr auto FIND = R"(
 static constexpr auto DELETE = R"(
   DELETE FROM File WHERE stage_id = :stage_id AND logical_path = :logical_path
 )";
+
+// driven by the File_state_physical_path index, which returns the paths in
+// order, so that DISTINCT does not need a temporary b-tree
+static constexpr auto FIND_STARTED_IN_INCOMPLETE_STAGES = R"(
+  SELECT DISTINCT File.physical_path FROM File
+  JOIN Stage ON Stage.id = File.stage_id
+  WHERE File.state = :state AND Stage.completed_at = 0
+  ORDER BY File.physical_path
+)";
+
+// the following updates apply to all the files whose path is in the
+// UpdatePath temporary table
+
+static constexpr auto START_BY_PHYSICAL_PATHS = R"(
+  UPDATE File SET state = :state, started_at = :tp
+  WHERE physical_path IN (SELECT path FROM temp.UpdatePath)
+    AND state = :submitted
+)";
+
+static constexpr auto FINISH_BY_PHYSICAL_PATHS = R"(
+  UPDATE File SET state = :state,
+    started_at = CASE WHEN started_at = 0 THEN :tp_start ELSE started_at END,
+    finished_at = :tp_end
+  WHERE physical_path IN (SELECT path FROM temp.UpdatePath)
+    AND state IN (:submitted, :started)
+)";
+
+static constexpr auto START_BY_LOGICAL_PATHS = R"(
+  UPDATE File SET state = :state, started_at = :tp
+  WHERE stage_id = :id AND logical_path IN (SELECT path FROM temp.UpdatePath)
+)";
+
+static constexpr auto FINISH_BY_LOGICAL_PATHS = R"(
+  UPDATE File SET state = :state,
+    started_at = CASE WHEN started_at = 0 THEN :tp_start ELSE started_at END,
+    finished_at = :tp_end
+  WHERE stage_id = :id AND logical_path IN (SELECT path FROM temp.UpdatePath)
+)";
 } // namespace File
+
+// ---------------------
+// UpdatePath Table
+// Temporary, per-connection table holding the set of paths targeted by a
+// batched update
+namespace UpdatePath {
+static constexpr auto CREATE_IF_NOT_EXISTS = R"(
+  CREATE TEMP TABLE IF NOT EXISTS UpdatePath (
+    path TEXT PRIMARY KEY
+  );
+)";
+
+static constexpr auto CLEAR = R"(
+  DELETE FROM temp.UpdatePath
+)";
+
+static constexpr auto INSERT = R"(
+  INSERT OR IGNORE INTO temp.UpdatePath VALUES (:path)
+)";
+} // namespace UpdatePath
+
+// ---------------------
+// PathState and StateCount Tables
+// Summary of the File table, maintained by triggers, so that the number of
+// distinct physical paths in a given state is available in constant time.
+// PathState counts the files for each (physical_path, state) pair; StateCount
+// counts the rows of PathState for each state.
+namespace PathState {
+static constexpr auto CREATE_IF_NOT_EXISTS = R"(
+  CREATE TABLE IF NOT EXISTS PathState (
+    physical_path TEXT    NOT NULL,
+    state         INTEGER NOT NULL,
+    refs          INTEGER NOT NULL,
+    PRIMARY KEY (physical_path, state)
+  ) WITHOUT ROWID;
+)";
+
+static constexpr auto CLEAR = R"(
+  DELETE FROM PathState
+)";
+
+static constexpr auto REBUILD = R"(
+  INSERT INTO PathState
+  SELECT physical_path, state, COUNT(*) FROM File
+  GROUP BY physical_path, state
+)";
+} // namespace PathState
+
+namespace StateCount {
+static constexpr auto CREATE_IF_NOT_EXISTS = R"(
+  CREATE TABLE IF NOT EXISTS StateCount (
+    state   INTEGER PRIMARY KEY,
+    n_paths INTEGER NOT NULL
+  );
+)";
+
+// one row for each File::State
+static constexpr auto INITIALIZE = R"(
+  INSERT OR IGNORE INTO StateCount VALUES (0, 0), (1, 0), (2, 0), (3, 0), (4, 0)
+)";
+
+static constexpr auto REBUILD = R"(
+  UPDATE StateCount SET n_paths = (
+    SELECT COUNT(*) FROM PathState WHERE PathState.state = StateCount.state
+  )
+)";
+
+static constexpr auto FIND_ALL = R"(
+  SELECT state, n_paths FROM StateCount ORDER BY state
+)";
+
+static constexpr auto FIND = R"(
+  SELECT n_paths FROM StateCount WHERE state = :state
+)";
+} // namespace StateCount
+
+namespace Trigger {
+// NEW.physical_path enters NEW.state
+#define STORM_SQL_ADD_PATH_STATE                                               \
+  "UPDATE StateCount SET n_paths = n_paths + 1 WHERE state = NEW.state "       \
+  "AND NOT EXISTS (SELECT 1 FROM PathState "                                  \
+  "WHERE physical_path = NEW.physical_path AND state = NEW.state); "          \
+  "INSERT OR IGNORE INTO PathState VALUES (NEW.physical_path, NEW.state, 0); " \
+  "UPDATE PathState SET refs = refs + 1 "                                      \
+  "WHERE physical_path = NEW.physical_path AND state = NEW.state; "
+
+// OLD.physical_path leaves OLD.state
+#define STORM_SQL_REMOVE_PATH_STATE                                            \
+  "UPDATE PathState SET refs = refs - 1 "                                      \
+  "WHERE physical_path = OLD.physical_path AND state = OLD.state; "           \
+  "UPDATE StateCount SET n_paths = n_paths - 1 WHERE state = OLD.state "       \
+  "AND EXISTS (SELECT 1 FROM PathState WHERE physical_path = "                 \
+  "OLD.physical_path AND state = OLD.state AND refs = 0); "                    \
+  "DELETE FROM PathState "                                                     \
+  "WHERE physical_path = OLD.physical_path AND state = OLD.state "            \
+  "AND refs = 0; "
+
+static constexpr auto FILE_AFTER_INSERT =
+    "CREATE TRIGGER IF NOT EXISTS File_after_insert AFTER INSERT ON File "
+    "BEGIN " STORM_SQL_ADD_PATH_STATE "END";
+
+static constexpr auto FILE_AFTER_DELETE =
+    "CREATE TRIGGER IF NOT EXISTS File_after_delete AFTER DELETE ON File "
+    "BEGIN " STORM_SQL_REMOVE_PATH_STATE "END";
+
+static constexpr auto FILE_AFTER_UPDATE =
+    "CREATE TRIGGER IF NOT EXISTS File_after_update "
+    "AFTER UPDATE OF physical_path, state ON File "
+    "WHEN OLD.physical_path IS NOT NEW.physical_path "
+    "OR OLD.state IS NOT NEW.state "
+    "BEGIN " STORM_SQL_REMOVE_PATH_STATE STORM_SQL_ADD_PATH_STATE "END";
+
+#undef STORM_SQL_ADD_PATH_STATE
+#undef STORM_SQL_REMOVE_PATH_STATE
+} // namespace Trigger
+
+// ---------------------
+// Schema migrations
+// The version of the schema is stored in the user_version pragma of the
+// database. MIGRATIONS[i] contains the statements that bring the schema from
+// version i to version i + 1. Existing migrations must never be modified; new
+// ones are appended at the end.
+namespace Schema {
+static constexpr auto GET_VERSION = R"(
+  PRAGMA user_version
+)";
+
+// pragmas do not support bound parameters, the version has to be formatted in
+static constexpr auto SET_VERSION = R"(
+  PRAGMA user_version = {}
+)";
+
+// initial schema
+static constexpr char const* V1[] = {Stage::CREATE_IF_NOT_EXISTS,
+                                     File::CREATE_IF_NOT_EXISTS};
+
+// indexes supporting the queries by state and by physical path
+static constexpr char const* V2[] = {
+    R"(
+  CREATE INDEX IF NOT EXISTS File_state_physical_path
+  ON File (state, physical_path)
+)",
+    R"(
+  CREATE INDEX IF NOT EXISTS File_physical_path
+  ON File (physical_path)
+)",
+    R"(
+  CREATE INDEX IF NOT EXISTS Stage_completed_at
+  ON Stage (completed_at)
+)"};
+
+// summary of the distinct physical paths per state
+static constexpr char const* V3[] = {
+    PathState::CREATE_IF_NOT_EXISTS, StateCount::CREATE_IF_NOT_EXISTS,
+    StateCount::INITIALIZE,          Trigger::FILE_AFTER_INSERT,
+    Trigger::FILE_AFTER_DELETE,      Trigger::FILE_AFTER_UPDATE};
+
+static constexpr std::array<std::span<char const* const>, 3> MIGRATIONS{
+    V1, V2, V3};
+} // namespace Schema
 } // namespace storm::sql
 #endif // STORM_TAPE_SQL_QUERIES_H
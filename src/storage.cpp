@@ -0,0 +1,88 @@
+#include "storage.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace storm {
+
+FileStatus FileStatuses::get(std::size_t i) const
+{
+  assert(i < size());
+  FileStatus status;
+  status.error       = errors[i];
+  status.type        = types[i];
+  status.size        = sizes[i];
+  status.is_stub     = is_stub[i] != 0;
+  status.in_progress = in_progress[i] != 0;
+  status.on_tape     = on_tape[i] != 0;
+  return status;
+}
+
+void FileStatuses::set(std::size_t i, FileStatus const& status)
+{
+  assert(i < size());
+  errors[i]      = status.error;
+  types[i]       = status.type;
+  sizes[i]       = status.size;
+  is_stub[i]     = status.is_stub;
+  in_progress[i] = status.in_progress;
+  on_tape[i]     = status.on_tape;
+}
+
+void FileStatuses::assign(std::size_t offset, FileStatuses const& other)
+{
+  assert(offset + other.size() <= size());
+  auto const at = static_cast<std::ptrdiff_t>(offset);
+  std::copy(other.errors.begin(), other.errors.end(), errors.begin() + at);
+  std::copy(other.types.begin(), other.types.end(), types.begin() + at);
+  std::copy(other.sizes.begin(), other.sizes.end(), sizes.begin() + at);
+  std::copy(other.is_stub.begin(), other.is_stub.end(), is_stub.begin() + at);
+  std::copy(other.in_progress.begin(), other.in_progress.end(),
+            in_progress.begin() + at);
+  std::copy(other.on_tape.begin(), other.on_tape.end(), on_tape.begin() + at);
+}
+
+FileStatuses Storage::file_statuses(std::span<PhysicalPath const> paths)
+{
+  FileStatuses result(paths.size());
+
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    auto const& path = paths[i];
+
+    std::error_code ec;
+    result.types[i] = fs::status(path, ec).type();
+    if (ec) {
+      result.errors[i] = ec;
+      continue;
+    }
+
+    auto const size_info = file_size_info(path);
+    if (size_info.has_error()) {
+      result.errors[i] = size_info.error();
+      continue;
+    }
+    result.sizes[i]   = size_info->size;
+    result.is_stub[i] = size_info->is_stub;
+
+    if (result.types[i] != fs::file_type::regular) {
+      continue;
+    }
+
+    auto const in_progress = is_in_progress(path);
+    if (in_progress.has_error()) {
+      result.errors[i] = in_progress.error();
+      continue;
+    }
+    result.in_progress[i] = *in_progress;
+
+    auto const on_tape = is_on_tape(path);
+    if (on_tape.has_error()) {
+      result.errors[i] = on_tape.error();
+      continue;
+    }
+    result.on_tape[i] = *on_tape;
+  }
+
+  return result;
+}
+
+} // namespace storm
@@ -2,15 +2,68 @@
 #define STORM_STORAGE_HPP
 
 #include "types.hpp"
+#include <span>
+#include <system_error>
+#include <vector>
 
 namespace storm {
 
+// The status of a file on the storage
+struct FileStatus
+{
+  std::error_code error{};
+  fs::file_type type{fs::file_type::none};
+  std::size_t size{0};
+  bool is_stub{false};
+  bool in_progress{false};
+  bool on_tape{false};
+};
+
+// The status of a set of files, as a struct of arrays. The elements at index i
+// refer to the i-th queried path; if errors[i] is set, the other elements at
+// index i are not meaningful.
+struct FileStatuses
+{
+  std::vector<std::error_code> errors;
+  std::vector<fs::file_type> types;
+  std::vector<std::size_t> sizes;
+  // not std::vector<bool>, so that different elements can be set concurrently
+  std::vector<char> is_stub;
+  std::vector<char> in_progress;
+  std::vector<char> on_tape;
+
+  FileStatuses() = default;
+  explicit FileStatuses(std::size_t n)
+      : errors(n)
+      , types(n, fs::file_type::none)
+      , sizes(n)
+      , is_stub(n)
+      , in_progress(n)
+      , on_tape(n)
+  {}
+  std::size_t size() const noexcept
+  {
+    return errors.size();
+  }
+  FileStatus get(std::size_t i) const;
+  void set(std::size_t i, FileStatus const& status);
+  // copy the elements of other starting at index offset
+  void assign(std::size_t offset, FileStatuses const& other);
+};
+
+// the functions may be called concurrently from multiple threads
 struct Storage
 {
   virtual ~Storage()                                            = default;
   virtual Result<bool> is_in_progress(PhysicalPath const& path) = 0;
   virtual Result<FileSizeInfo> file_size_info(PhysicalPath const& path) = 0;
   virtual Result<bool> is_on_tape(PhysicalPath const& path)             = 0;
+  // query all of the above for many files at once; the xattrs are queried only
+  // for regular files. The default implementation calls the functions above
+  // for each file.
+  virtual FileStatuses file_statuses(std::span<PhysicalPath const> paths);
+  // mark the file as being recalled, i.e. set the user.TSMRecT xattr
+  virtual Result<void> set_in_progress(PhysicalPath const& path) = 0;
 };
 
 } // namespace storm
@@ -1,86 +1,175 @@
 #include "storage_area_resolver.hpp"
 #include "errors.hpp"
 #include <algorithm>
-#include <memory>
 #include <numeric>
-#include <optional>
 
 namespace storm {
 
 namespace {
 
-using PrefixMatchOpt = std::optional<std::ptrdiff_t>;
-
-PrefixMatchOpt prefix_match(LogicalPath const& path, LogicalPath const& ap)
+// Whether the path is absolute and has no "." or ".." components, which is
+// equivalent to path == path.lexically_normal() for an absolute path
+bool is_valid(std::string_view s)
 {
-  auto [_, it] = std::mismatch(path.begin(), path.end(), ap.begin(), ap.end());
-  if (it == ap.end()) {
-    // full prefix match
-    return std::distance(ap.begin(), it);
-  } else {
-    return std::nullopt;
+  if (s.empty() || s.front() != '/') {
+    return false;
+  }
+  for (std::size_t pos = 1; pos < s.size();) {
+    auto end = s.find('/', pos);
+    if (end == std::string_view::npos) {
+      end = s.size();
+    }
+    auto const c = s.substr(pos, end - pos);
+    if (c == "." || c == "..") {
+      return false;
+    }
+    pos = end + 1;
   }
+  return true;
+}
+
+// Collapse the repeated separators, which fs::path ignores when comparing
+// and iterating paths
+std::string collapse_separators(std::string_view s)
+{
+  std::string result;
+  result.reserve(s.size());
+  std::unique_copy(s.begin(), s.end(), std::back_inserter(result),
+                   [](char a, char b) { return a == '/' && b == '/'; });
+  return result;
 }
 
-struct BestMatch
+} // namespace
+
+StorageAreaResolver::StorageAreaResolver(StorageAreas const& sas)
+    : m_nodes(1)
 {
-  std::ptrdiff_t match_size{};
-  LogicalPath const* path{nullptr};
-  StorageArea const* sa{nullptr};
-  friend auto operator<(BestMatch const& bm1, BestMatch const& bm2)
-  {
-    return bm1.match_size < bm2.match_size;
+  BOOST_ASSERT(!sas.empty());
+
+  for (auto const& sa : sas) {
+    for (auto const& ap : sa.access_points) {
+      if (!ap.has_root_directory()) {
+        // an access point is absolute, see the configuration
+        continue;
+      }
+      std::uint32_t n{0};
+      // skip the root directory, which corresponds to the first node
+      for (auto it = std::next(ap.begin()); it != ap.end(); ++it) {
+        auto const [child, inserted] = m_nodes[n].children.try_emplace(
+            it->native(), static_cast<std::uint32_t>(m_nodes.size()));
+        n = child->second;
+        if (inserted) {
+          m_nodes.emplace_back();
+        }
+      }
+      m_nodes[n].root = &sa.root;
+    }
   }
-};
+}
 
-using BestMatchOpt = std::optional<BestMatch>;
+// Advance the walk by the component of the path in [first, last)
+void StorageAreaResolver::advance(Walk& w, std::string_view path,
+                                  std::size_t first, std::size_t last) const
+{
+  if (w.stopped) {
+    return;
+  }
+  auto const& children = m_nodes[w.node].children;
+  auto const it        = children.find(path.substr(first, last - first));
+  if (it == children.end()) {
+    w.stopped = true;
+    return;
+  }
+  w.node = it->second;
+  if (m_nodes[w.node].root != nullptr) {
+    w.root = m_nodes[w.node].root;
+    w.rest = last + 1;
+  }
+}
 
-} // namespace
+// Walk along the components of the path that precede the separator at
+// position last, i.e. along its directory
+StorageAreaResolver::Walk StorageAreaResolver::walk(std::string_view path,
+                                                    std::size_t last) const
+{
+  Walk w{0, false, m_nodes[0].root, 1};
+  for (std::size_t pos = 1; pos < last && !w.stopped;) {
+    auto const end = path.find('/', pos);
+    advance(w, path, pos, end);
+    pos = end + 1;
+  }
+  return w;
+}
 
-PhysicalPath StorageAreaResolver::operator()(LogicalPath const& path) const
+// Complete the walk with the last component of the path, which is empty if
+// the path ends with a separator, and build the physical path
+PhysicalPath StorageAreaResolver::finish(Walk w, std::string_view path) const
 {
-  if (path.is_relative() || path != path.lexically_normal()) {
+  if (path.size() > 1) {
+    advance(w, path, path.rfind('/') + 1, path.size());
+  }
+
+  if (w.root == nullptr) {
     return PhysicalPath{};
   }
 
-  BOOST_ASSERT(!m_sas.empty());
-
-  // find the access point that is the longest prefix of the path, with the
-  // corresponding SA
-  auto best_match = std::transform_reduce(
-      m_sas.begin(), m_sas.end(), BestMatchOpt{},
-      [](BestMatchOpt const& bm1, BestMatchOpt const& bm2) {
-        return std::max(bm1, bm2);
-      },
-      [&](StorageArea const& sa) -> BestMatchOpt {
-        // find the access point in this SA that is the longest prefix of the
-        // path, if it exists
-        auto ap_it = std::max_element(
-            sa.access_points.begin(), sa.access_points.end(),
-            [&](auto& ap1, auto& ap2) {
-              return prefix_match(path, ap1) < prefix_match(path, ap2);
-            });
-        if (auto m = prefix_match(path, *ap_it); m.has_value()) {
-          return BestMatch{*m, std::to_address(ap_it),
-                           std::addressof(sa)};
-        } else {
-          return std::nullopt;
-        }
-      });
+  if (w.rest >= path.size()) {
+    // path is exactly the access point
+    return *w.root;
+  }
+
+  auto result = w.root->native();
+  if (!result.ends_with('/')) {
+    result.push_back('/');
+  }
+  result.append(path.substr(w.rest));
+  return PhysicalPath{std::move(result)};
+}
+
+PhysicalPath StorageAreaResolver::operator()(LogicalPath const& path) const
+{
+  return Batch{*this}(path);
+}
 
-  if (!best_match) {
+PhysicalPath StorageAreaResolver::Batch::operator()(LogicalPath const& path)
+{
+  std::string_view const s{path.native()};
+  if (!is_valid(s)) {
     return PhysicalPath{};
   }
 
-  auto const rel_path = path.lexically_relative(*best_match->path);
-  BOOST_ASSERT(!rel_path.empty());
+  if (s.find("//") != std::string_view::npos) {
+    auto const collapsed = collapse_separators(s);
+    return m_resolver.finish(
+        m_resolver.walk(collapsed, collapsed.rfind('/')), collapsed);
+  }
 
-  if (rel_path == ".") {
-    // path is exactly the access point
-    return best_match->sa->root;
+  // the directory includes the trailing separator
+  auto const dir = s.substr(0, s.rfind('/') + 1);
+  if (dir != m_dir) {
+    m_dir  = dir;
+    m_walk = m_resolver.walk(s, dir.size() - 1);
   }
+  return m_resolver.finish(m_walk, s);
+}
+
+void StorageAreaResolver::operator()(std::span<LogicalPath const> paths,
+                                     std::span<PhysicalPath> out) const
+{
+  BOOST_ASSERT(paths.size() == out.size());
 
-  return static_cast<PhysicalPath>(best_match->sa->root / rel_path);
+  // in lexicographic order the paths in the same directory are mostly
+  // adjacent
+  std::vector<std::size_t> order(paths.size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+    return paths[a].native() < paths[b].native();
+  });
+
+  Batch resolve{*this};
+  for (auto const i : order) {
+    out[i] = resolve(paths[i]);
+  }
 }
 
 } // namespace storm
@@ -2,18 +2,72 @@
 #define STORM_STORAGE_AREA_RESOLVER_HPP
 
 #include "configuration.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace storm {
 
+// Map a logical path to the corresponding physical path, according to the
+// access point that is its longest prefix.
+//
+// The access points of all the storage areas are compiled once in a trie of
+// path components, so that a path is resolved in a single walk along its
+// components. The storage areas must outlive the resolver.
 class StorageAreaResolver
 {
-  StorageAreas const& m_sas;
+  struct Node
+  {
+    std::map<std::string, std::uint32_t, std::less<>> children;
+    // the root of the storage area, if an access point ends here
+    PhysicalPath const* root{nullptr};
+  };
+
+  // the state of a walk along the trie
+  struct Walk
+  {
+    std::uint32_t node{0};
+    bool stopped{false};
+    // the deepest access point found so far and where the rest of the path
+    // starts
+    PhysicalPath const* root{nullptr};
+    std::size_t rest{1};
+  };
+
+  // the first node corresponds to "/"
+  std::vector<Node> m_nodes;
+
+  Walk walk(std::string_view path, std::size_t last) const;
+  void advance(Walk& w, std::string_view path, std::size_t first,
+               std::size_t last) const;
+  PhysicalPath finish(Walk w, std::string_view path) const;
 
  public:
-  StorageAreaResolver(StorageAreas const& sas)
-      : m_sas{sas}
-  {}
+  // Resolve paths one after the other, reusing the walk along the directory
+  // of the previous path if the next one is in the same directory. The
+  // previous path must still be alive.
+  class Batch
+  {
+    StorageAreaResolver const& m_resolver;
+    std::string_view m_dir;
+    Walk m_walk;
+
+   public:
+    explicit Batch(StorageAreaResolver const& resolver)
+        : m_resolver{resolver}
+    {}
+    PhysicalPath operator()(LogicalPath const& path);
+  };
+
+  StorageAreaResolver(StorageAreas const& sas);
   PhysicalPath operator()(LogicalPath const& path) const;
+  // resolve paths[i] into out[i]; the two spans must have the same size
+  void operator()(std::span<LogicalPath const> paths,
+                  std::span<PhysicalPath> out) const;
 };
 
 } // namespace storm
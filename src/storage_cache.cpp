@@ -0,0 +1,78 @@
+#include "storage_cache.hpp"
+#include "inotify_watcher.hpp"
+#include "locality_cache.hpp"
+#include "profiler.hpp"
+
+namespace storm {
+
+CachingStorage::CachingStorage(Storage& storage, LocalityCache& cache,
+                               bool use_inotify)
+    : m_storage{storage}
+    , m_cache{cache}
+    , m_watcher{use_inotify ? std::make_unique<InotifyWatcher>(cache) : nullptr}
+{}
+
+CachingStorage::~CachingStorage() = default;
+
+Result<bool> CachingStorage::is_in_progress(PhysicalPath const& path)
+{
+  return m_storage.is_in_progress(path);
+}
+
+Result<FileSizeInfo> CachingStorage::file_size_info(PhysicalPath const& path)
+{
+  return m_storage.file_size_info(path);
+}
+
+Result<bool> CachingStorage::is_on_tape(PhysicalPath const& path)
+{
+  return m_storage.is_on_tape(path);
+}
+
+FileStatuses CachingStorage::file_statuses(std::span<PhysicalPath const> paths)
+{
+  PROFILE_FUNCTION();
+  FileStatuses result(paths.size());
+
+  // the indexes and the paths of the files not found in the cache
+  std::vector<std::size_t> missed;
+  PhysicalPaths missed_paths;
+
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    if (auto const status = m_cache.find(paths[i]); status.has_value()) {
+      result.set(i, *status);
+    } else {
+      missed.push_back(i);
+      missed_paths.push_back(paths[i]);
+    }
+  }
+
+  if (missed.empty()) {
+    return result;
+  }
+
+  auto const statuses = m_storage.file_statuses(missed_paths);
+  for (std::size_t k = 0; k != missed.size(); ++k) {
+    auto const status = statuses.get(k);
+    result.set(missed[k], status);
+    if (status.error == std::error_code{}) {
+      // a change between the query and the start of the watch is only caught
+      // by the expiration of the entry
+      if (m_watcher) {
+        m_watcher->watch(missed_paths[k]);
+      }
+      m_cache.insert(missed_paths[k], status);
+    }
+  }
+
+  return result;
+}
+
+Result<void> CachingStorage::set_in_progress(PhysicalPath const& path)
+{
+  auto result = m_storage.set_in_progress(path);
+  m_cache.invalidate(path);
+  return result;
+}
+
+} // namespace storm
@@ -0,0 +1,37 @@
+#ifndef STORM_STORAGE_CACHE_HPP
+#define STORM_STORAGE_CACHE_HPP
+
+#include "storage.hpp"
+#include <memory>
+
+namespace storm {
+
+class LocalityCache;
+class InotifyWatcher;
+
+// Storage that answers the batch queries from a LocalityCache, forwarding
+// only the misses to another Storage.
+//
+// The single-file queries are always forwarded. Only successful queries are
+// cached. The entry of a file is invalidated when the file is marked as in
+// progress through this object and, optionally, when inotify reports a change
+// in the directory containing the file.
+class CachingStorage : public Storage
+{
+  Storage& m_storage;
+  LocalityCache& m_cache;
+  std::unique_ptr<InotifyWatcher> m_watcher;
+
+ public:
+  CachingStorage(Storage& storage, LocalityCache& cache, bool use_inotify);
+  ~CachingStorage() override;
+  Result<bool> is_in_progress(PhysicalPath const& path) override;
+  Result<FileSizeInfo> file_size_info(PhysicalPath const& path) override;
+  Result<bool> is_on_tape(PhysicalPath const& path) override;
+  FileStatuses file_statuses(std::span<PhysicalPath const> paths) override;
+  Result<void> set_in_progress(PhysicalPath const& path) override;
+};
+
+} // namespace storm
+
+#endif // STORM_STORAGE_CACHE_HPP
@@ -5,7 +5,6 @@
 #include "database.hpp"
 #include "delete_response.hpp"
 #include "errors.hpp"
-#include "extended_attributes.hpp"
 #include "in_progress_response.hpp"
 #include "io.hpp"
 #include "profiler.hpp"
@@ -22,12 +21,20 @@
 #include <crow/logging.h>
 #include <fmt/core.h>
 #include <ctime>
-#include <numeric>
 #include <span>
 #include <string>
 
 namespace storm {
 
+TapeService::TapeService(Configuration const& config, Database& db,
+                         Storage& storage)
+    : m_config{config}
+    , m_db(db)
+    , m_storage(storage)
+    , m_resolve{config.storage_areas}
+    , m_io{config.io_threads}
+{}
+
 StageResponse TapeService::stage(StageRequest stage_request)
 {
   PROFILE_FUNCTION();
@@ -43,7 +50,8 @@ StageResponse TapeService::stage(StageRequest stage_request)
                           }),
               files.end());
 
-  StorageAreaResolver resolve{m_config.storage_areas};
+  // the files are sorted, so consecutive files often share the directory
+  StorageAreaResolver::Batch resolve{m_resolve};
   for (auto& file : files) {
     file.physical_path = resolve(file.logical_path);
     std::error_code ec;
@@ -54,7 +62,10 @@ StageResponse TapeService::stage(StageRequest stage_request)
       file.finished_at = file.started_at;
     }
   }
-  auto const uuid     = m_uuid_gen();
+  auto const uuid = [&] {
+    std::lock_guard lock{m_uuid_mutex};
+    return m_uuid_gen();
+  }();
   auto const id       = to_string(uuid);
   auto const inserted = m_db.insert(id, stage_request);
   if (!inserted) {
@@ -64,14 +75,6 @@ StageResponse TapeService::stage(StageRequest stage_request)
   return inserted ? StageResponse{id, std::move(files)} : StageResponse{};
 }
 
-static bool recall_in_progress(PhysicalPath const& path)
-{
-  XAttrName const tsm_rect{"user.TSMRecT"};
-  std::error_code ec;
-  auto const in_progress = has_xattr(path, tsm_rect, ec);
-  return ec == std::error_code{} && in_progress;
-}
-
 static bool override_locality(Locality& locality, PhysicalPath const& path)
 {
   if (locality == Locality::lost) {
@@ -88,118 +91,56 @@ static bool override_locality(Locality& locality, PhysicalPath const& path)
 
 namespace {
 
+// The status of the i-th file of a batch query to the storage
 class ExtendedFileStatus
 {
-  Storage& m_storage;
-  PhysicalPath const& m_path;
-  std::error_code m_ec{};
-  template<typename T>
-  using Cached = std::optional<T>;
-  Cached<bool> m_in_progress{std::nullopt};
-  Cached<FileSizeInfo> m_file_size_info{std::nullopt};
-  Cached<bool> m_on_tape{std::nullopt};
+  FileStatuses const& m_statuses;
+  std::size_t m_i;
 
  public:
-  ExtendedFileStatus(Storage& storage, PhysicalPath const& path)
-      : m_storage(storage)
-      , m_path(path)
+  ExtendedFileStatus(FileStatuses const& statuses, std::size_t i)
+      : m_statuses(statuses)
+      , m_i(i)
   {}
   auto error() const noexcept
   {
-    return m_ec;
+    return m_statuses.errors[m_i];
   }
   explicit operator bool() const noexcept
   {
-    return m_ec == std::error_code{};
+    return error() == std::error_code{};
   }
-  bool is_in_progress()
+  auto type() const noexcept
   {
-    bool ret{false};
-    if (m_in_progress.has_value()) {
-      ret = *m_in_progress;
-    } else {
-      auto result = m_storage.is_in_progress(m_path);
-      auto ec     = result.error();
-      if (ec.failed()) {
-        // log something
-        m_ec = ec;
-      } else {
-        m_in_progress = *result;
-        ret           = *m_in_progress;
-      }
-    }
-    return ret;
+    return m_statuses.types[m_i];
   }
-  bool is_stub()
+  bool is_in_progress() const noexcept
   {
-    bool ret{false};
-    if (m_file_size_info.has_value()) {
-      ret = m_file_size_info->is_stub;
-    } else {
-      auto result = m_storage.file_size_info(m_path);
-      auto ec     = result.error();
-      if (ec.failed()) {
-        // log something
-        m_ec = ec;
-      } else {
-        m_file_size_info = *result;
-        ret              = m_file_size_info->is_stub;
-      }
-    }
-    return ret;
+    return m_statuses.in_progress[m_i];
   }
-  auto file_size()
+  bool is_stub() const noexcept
   {
-    std::size_t ret{0};
-    if (m_file_size_info.has_value()) {
-      ret = m_file_size_info->size;
-    } else {
-      auto result = m_storage.file_size_info(m_path);
-      auto ec     = result.error();
-      if (ec.failed()) {
-        // log something
-        m_ec = ec;
-      } else {
-        m_file_size_info = *result;
-        ret              = m_file_size_info->size;
-      }
-    }
-    return ret;
+    return m_statuses.is_stub[m_i];
   }
-  bool is_on_tape()
+  auto file_size() const noexcept
   {
-    bool ret{false};
-    if (m_on_tape.has_value()) {
-      ret = *m_on_tape;
-    } else {
-      auto result = m_storage.is_on_tape(m_path);
-      auto ec     = result.error();
-      if (ec.failed()) {
-        // log something
-        m_ec = ec;
-      } else {
-        m_on_tape = *result;
-        ret       = *m_on_tape;
-      }
-    }
-    return ret;
+    return m_statuses.sizes[m_i];
   }
-  Locality locality()
+  bool is_on_tape() const noexcept
+  {
+    return m_statuses.on_tape[m_i];
+  }
+  Locality locality() const noexcept
   {
-    auto const file_size_ = file_size();
     if (error() != std::error_code{}) {
       return Locality::unavailable;
     }
-    if (file_size_ == 0) {
+    if (file_size() == 0) {
       return Locality::none;
     }
     bool const is_on_disk_{!(is_stub() || is_in_progress())};
     bool const is_on_tape_{is_on_tape()};
 
-    if (error() != std::error_code{}) {
-      return Locality::unavailable;
-    }
-
     if (is_on_disk_) {
       return is_on_tape_ ? Locality::disk_and_tape : Locality::disk;
     } else {
@@ -208,6 +149,74 @@ class ExtendedFileStatus
   }
 };
 
+// Query the storage about a set of files, splitting them in chunks that are
+// processed in parallel
+FileStatuses probe(Storage& storage, IoExecutor& io,
+                   std::span<PhysicalPath const> paths)
+{
+  PROFILE_FUNCTION();
+  // small enough to keep all the threads busy, large enough to amortize the
+  // dispatch of the chunks
+  constexpr std::size_t max_chunk_size{64};
+  auto const n_workers  = io.size() + 1;
+  auto const chunk_size = std::clamp<std::size_t>(
+      (paths.size() + n_workers - 1) / n_workers, 1, max_chunk_size);
+  auto const n_chunks = (paths.size() + chunk_size - 1) / chunk_size;
+
+  FileStatuses result(paths.size());
+  io.for_each_index(n_chunks, [&](std::size_t k) {
+    auto const offset = k * chunk_size;
+    auto const chunk =
+        paths.subspan(offset, std::min(chunk_size, paths.size() - offset));
+    result.assign(offset, storage.file_statuses(chunk));
+  });
+  return result;
+}
+
+// Determine the actual state of a file, given its status on the storage, and
+// update it in place. Return whether the state has changed.
+bool refresh_state(File& file, ExtendedFileStatus const& file_status,
+                   TimePoint now)
+{
+  switch (file.state) {
+  case File::State::started: {
+    if (file_status.is_in_progress()) {
+      return false;
+    }
+    file.state =
+        file_status.is_stub() ? File::State::failed : File::State::completed;
+    file.finished_at = now;
+    return true;
+  }
+
+  case File::State::completed:
+  case File::State::cancelled:
+  case File::State::failed:
+    // do nothing
+    return false;
+
+  case File::State::submitted: {
+    if (file_status && file_status.is_in_progress()) {
+      file.state      = File::State::started;
+      file.started_at = now;
+      return true;
+    } else if (file_status && !file_status.is_stub()) {
+      file.state       = File::State::completed;
+      file.started_at  = now;
+      file.finished_at = now;
+      return true;
+    } else if (!file_status) {
+      file.state       = File::State::failed;
+      file.started_at  = now;
+      file.finished_at = now;
+      return true;
+    }
+    return false;
+  }
+  }
+  return false;
+}
+
 } // namespace
 
 StatusResponse TapeService::status(StageId const& id)
@@ -219,50 +228,68 @@ StatusResponse TapeService::status(StageId const& id)
     throw StageNotFound(id);
   }
 
-  const auto now = std::time(nullptr);
+  // the state of the files is kept up to date by reconcile()
+  auto& stage = *maybe_stage;
+  std::sort(stage.files.begin(), stage.files.end(),
+            [](auto const& f1, auto const& f2) {
+              return to_underlying(f1.state) < to_underlying(f2.state);
+            });
+
+  return StatusResponse{id, std::move(stage)};
+}
+
+void TapeService::reconcile()
+{
+  PROFILE_FUNCTION();
+  for (auto const& id : m_db.find_incomplete_stages()) {
+    reconcile(id);
+  }
+}
+
+void TapeService::reconcile(StageId const& id)
+{
+  PROFILE_FUNCTION();
+  auto maybe_stage = m_db.find(id);
+
+  if (!maybe_stage.has_value()) {
+    // erased in the meantime
+    return;
+  }
 
   // determine the actual state of files and update the db
-  std::vector<std::pair<PhysicalPath, File::State>> files_to_update;
   auto& stage = *maybe_stage;
-  for (auto& files = stage.files; auto& file : files) {
-    ExtendedFileStatus file_status{m_storage, file.physical_path};
-
-    switch (file.state) {
-    case File::State::started: {
-      if (file_status.is_in_progress()) {
-        break;
-      }
-      file.state =
-          file_status.is_stub() ? File::State::failed : File::State::completed;
-      file.finished_at = now;
-      files_to_update.emplace_back(file.physical_path, file.state);
-      break;
+  std::vector<File*> pending;
+  for (auto& file : stage.files) {
+    if (file.state == File::State::submitted
+        || file.state == File::State::started) {
+      pending.push_back(&file);
     }
+  }
 
-    case File::State::completed:
-    case File::State::cancelled:
-    case File::State::failed:
-      // do nothing
-      break;
-
-    case File::State::submitted: {
-      if (file_status && file_status.is_in_progress()) {
-        file.state      = File::State::started;
-        file.started_at = now;
-        files_to_update.emplace_back(file.physical_path, File::State::started);
-      } else if (file_status && !file_status.is_stub()) {
-        file.state       = File::State::completed;
-        file.started_at  = now;
-        file.finished_at = now;
-        files_to_update.emplace_back(file.physical_path, file.state);
-      } else if (!file_status) {
-        file.state       = File::State::failed;
-        file.started_at  = now;
-        file.finished_at = now;
-        files_to_update.emplace_back(file.physical_path, file.state);
+  PhysicalPaths paths;
+  paths.reserve(pending.size());
+  std::transform(pending.begin(), pending.end(), std::back_inserter(paths),
+                 [](File const* file) { return file->physical_path; });
+
+  // probe and update the files in batches, so that the progress of a large
+  // stage becomes visible incrementally and the db is not locked for long
+  auto const batch_size = m_config.reconciler.batch_size;
+  std::vector<std::pair<PhysicalPath, File::State>> files_to_update;
+  for (std::size_t first = 0; first < pending.size(); first += batch_size) {
+    auto const batch = std::span{paths}.subspan(
+        first, std::min(batch_size, paths.size() - first));
+    auto const statuses = probe(m_storage, m_io, batch);
+    auto const now      = std::time(nullptr);
+
+    files_to_update.clear();
+    for (std::size_t i = 0; i != batch.size(); ++i) {
+      auto& file = *pending[first + i];
+      if (refresh_state(file, ExtendedFileStatus{statuses, i}, now)) {
+        files_to_update.emplace_back(std::move(batch[i]), file.state);
       }
-      break;
     }
+    if (!files_to_update.empty()) {
+      m_db.update(StageUpdate{std::nullopt, files_to_update, now});
     }
   }
 
@@ -271,14 +298,12 @@ StatusResponse TapeService::status(StageId const& id)
               return to_underlying(f1.state) < to_underlying(f2.state);
             });
 
-  auto const updated = stage.update_timestamps();
-  StageUpdate stage_update{
-      updated ? std::optional(StageEntity{id, stage.created_at,
-                                          stage.started_at, stage.completed_at})
-              : std::nullopt,
-      files_to_update, now};
-  m_db.update(stage_update);
-  return StatusResponse{id, std::move(stage)};
+  if (stage.update_timestamps()) {
+    m_db.update(StageUpdate{StageEntity{id, stage.created_at, stage.started_at,
+                                        stage.completed_at},
+                            {},
+                            std::time(nullptr)});
+  }
 }
 
 CancelResponse TapeService::cancel(StageId const& id, CancelRequest cancel)
@@ -359,41 +384,38 @@ ReleaseResponse TapeService::release(StageId const& id,
 ArchiveInfoResponse TapeService::archive_info(ArchiveInfoRequest info)
 {
   PROFILE_FUNCTION();
-  PathInfos infos;
   auto& paths = info.paths;
+  PathInfos infos;
   infos.reserve(paths.size());
 
-  StorageAreaResolver resolve{m_config.storage_areas};
-
-  std::transform( //
-      paths.begin(), paths.end(), std::back_inserter(infos),
-      [&](LogicalPath& logical_path) {
-        using namespace std::string_literals;
-
-        auto const physical_path = resolve(logical_path);
-        std::error_code ec;
-        auto status = fs::status(physical_path, ec);
-
-        // if the file doesn't exist, fs::status sets ec, so check first for
-        // existence
-        if (!fs::exists(status)) {
-          return PathInfo{std::move(logical_path),
-                          "No such file or directory"s};
-        }
-        if (ec != std::error_code{}) {
-          return PathInfo{std::move(logical_path), Locality::unavailable};
-        }
-        if (fs::is_directory(status)) {
-          return PathInfo{std::move(logical_path), "Is a directory"s};
-        }
-        if (!fs::is_regular_file(status)) {
-          return PathInfo{std::move(logical_path), "Not a regular file"s};
-        }
-        auto locality =
-            ExtendedFileStatus{m_storage, physical_path}.locality();
-        override_locality(locality, physical_path);
-        return PathInfo{std::move(logical_path), locality};
-      });
+  PhysicalPaths physical_paths(paths.size());
+  m_resolve(paths, physical_paths);
+
+  auto const statuses = probe(m_storage, m_io, physical_paths);
+
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    using namespace std::string_literals;
+
+    auto& logical_path = paths[i];
+    ExtendedFileStatus const file_status{statuses, i};
+    auto const ec = file_status.error();
+
+    if (ec == std::errc::no_such_file_or_directory
+        || ec == std::errc::not_a_directory) {
+      infos.emplace_back(std::move(logical_path),
+                         "No such file or directory"s);
+    } else if (ec != std::error_code{}) {
+      infos.emplace_back(std::move(logical_path), Locality::unavailable);
+    } else if (file_status.type() == fs::file_type::directory) {
+      infos.emplace_back(std::move(logical_path), "Is a directory"s);
+    } else if (file_status.type() != fs::file_type::regular) {
+      infos.emplace_back(std::move(logical_path), "Not a regular file"s);
+    } else {
+      auto locality = file_status.locality();
+      override_locality(locality, physical_paths[i]);
+      infos.emplace_back(std::move(logical_path), locality);
+    }
+  }
 
   return ArchiveInfoResponse{infos};
 }
@@ -405,18 +427,57 @@ ReadyTakeOverResponse TapeService::ready_take_over()
   return ReadyTakeOverResponse{n};
 }
 
-using PathLocality = std::pair<PhysicalPath, Locality>;
+// Set the xattr that marks the files as in progress, in parallel, and return
+// the outcome for each file. The failures are logged together.
+static std::vector<std::error_code>
+mark_in_progress(Storage& storage, IoExecutor& io,
+                 std::span<PhysicalPath const> paths)
+{
+  PROFILE_FUNCTION();
+  std::vector<std::error_code> errors(paths.size());
+  io.for_each_index(paths.size(), [&](std::size_t i) {
+    if (auto const result = storage.set_in_progress(paths[i]);
+        result.has_error()) {
+      errors[i] = result.error();
+    }
+  });
+
+  auto const failed = [](std::error_code const& ec) {
+    return ec != std::error_code{};
+  };
+  if (auto const it = std::find_if(errors.begin(), errors.end(), failed);
+      it != errors.end()) {
+    auto const& path = paths[static_cast<std::size_t>(it - errors.begin())];
+    CROW_LOG_WARNING << fmt::format(
+        "Cannot create xattr user.TSMRecT for {} of {} files, e.g. {}: {}",
+        std::count_if(it, errors.end(), failed), paths.size(), path.string(),
+        it->message());
+  }
+
+  return errors;
+}
+
+struct PathLocality
+{
+  PhysicalPath path;
+  Locality locality;
+  // a recall is already in progress, i.e. the file has the user.TSMRecT xattr
+  bool in_progress;
+};
 
 static auto extend_paths_with_localities(PhysicalPaths&& paths,
-                                         Storage& storage)
+                                         Storage& storage, IoExecutor& io)
 {
   PROFILE_FUNCTION();
+  auto const statuses = probe(storage, io, paths);
+
   std::vector<PathLocality> path_localities;
   path_localities.reserve(paths.size());
 
-  for (auto&& path : paths) {
-    auto const locality = ExtendedFileStatus{storage, path}.locality();
-    path_localities.emplace_back(std::move(path), locality);
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    ExtendedFileStatus const file_status{statuses, i};
+    path_localities.push_back({std::move(paths[i]), file_status.locality(),
+                               file_status && file_status.is_in_progress()});
   }
 
   return path_localities;
@@ -427,9 +488,9 @@ static auto select_only_on_tape(
 {
   auto const it = std::partition(path_locs.begin(), path_locs.end(),
                                  [&](auto const& path_loc) {
-                                   return path_loc.second == Locality::tape
+                                   return path_loc.locality == Locality::tape
                                        // let's try also apparently-lost files
-                                       || path_loc.second == Locality::lost;
+                                       || path_loc.locality == Locality::lost;
                                  });
   return std::tuple{std::span{path_locs.begin(), it},
                     std::span{it, path_locs.end()}};
@@ -439,7 +500,7 @@ static auto select_in_progress(std::span<PathLocality> path_locs)
 {
   auto const it = std::partition(
       path_locs.begin(), path_locs.end(),
-      [](auto const& path_loc) { return recall_in_progress(path_loc.first); });
+      [](auto const& path_loc) { return path_loc.in_progress; });
   return std::tuple{std::span{path_locs.begin(), it},
                     std::span{it, path_locs.end()}};
 }
@@ -449,8 +510,8 @@ static auto select_on_disk(
 {
   auto const it = std::partition(
       path_locs.begin(), path_locs.end(), [](auto const& path_loc) {
-        return path_loc.second == Locality::disk
-            || path_loc.second == Locality::disk_and_tape;
+        return path_loc.locality == Locality::disk
+            || path_loc.locality == Locality::disk_and_tape;
       });
   return std::tuple{std::span{path_locs.begin(), it},
                     std::span{it, path_locs.end()}};
@@ -462,7 +523,7 @@ TakeOverResponse TapeService::take_over(TakeOverRequest req)
   auto physical_paths = m_db.get_files(File::State::submitted, req.n_files);
 
   auto path_locs =
-      extend_paths_with_localities(std::move(physical_paths), m_storage);
+      extend_paths_with_localities(std::move(physical_paths), m_storage, m_io);
 
   auto [only_on_tape, not_only_on_tape] = select_only_on_tape(path_locs);
   auto [in_progress, need_recall]       = select_in_progress(only_on_tape);
@@ -470,7 +531,7 @@ TakeOverResponse TapeService::take_over(TakeOverRequest req)
 
   auto const now = std::time(nullptr);
 
-  auto proj = [](auto const& file_loc) { return file_loc.first; };
+  auto proj = [](auto const& file_loc) { return file_loc.path; };
 
   // reuse physical_paths, premature optimization?
   // reserve enough space for all the following assignments
@@ -498,102 +559,35 @@ TakeOverResponse TapeService::take_over(TakeOverRequest req)
       boost::make_transform_iterator(need_recall.begin(), proj),
       boost::make_transform_iterator(need_recall.end(), proj));
 
+  // the files that are marked as in progress on the storage move to the front
+  auto n_marked = physical_paths.size();
   if (!m_config.mirror_mode) {
-    // first set the xattr, then update the DB. failing to update the DB is not
-    // a big deal, because the file stays in submitted state and can be passed
-    // later again to GEMSS. passing a file to GEMSS is mostly an idempotent
+    // first set the xattr, then update the DB. a file whose xattr cannot be
+    // set is not passed to GEMSS and stays in submitted state, to be tried
+    // again at a later take over. a file whose DB update fails is passed
+    // again to GEMSS at a later take over, which is mostly an idempotent
     // operation
-    // clang-format off
-    std::for_each(
-        physical_paths.begin(), physical_paths.end(), [&](auto& physical_path) {
-          XAttrName const tsm_rect{"user.TSMRecT"};
-          std::error_code ec;
-          create_xattr(physical_path, tsm_rect, ec);
-          if (ec != std::error_code{}) {
-            CROW_LOG_WARNING << fmt::format("Cannot create xattr {} for file {}",
-                                            tsm_rect.value(),
-                                            physical_path.string());
-          }
-        });
-    // clang-format on
+    auto const errors = mark_in_progress(m_storage, m_io, physical_paths);
+    n_marked          = 0;
+    for (std::size_t i = 0; i != physical_paths.size(); ++i) {
+      if (errors[i] == std::error_code{}) {
+        std::swap(physical_paths[n_marked], physical_paths[i]);
+        ++n_marked;
+      }
+    }
   }
-  m_db.update(physical_paths, File::State::started, now);
+  m_db.update(std::span<PhysicalPath const>{physical_paths}.first(n_marked),
+              File::State::started, now);
+  physical_paths.resize(n_marked);
 
   return TakeOverResponse{std::move(physical_paths)};
 }
 
-namespace {
-
-auto to_underlying_state(File::State s)
-{
-  return to_underlying(s);
-}
-
-auto to_underlying_state(File const& f)
-{
-  return to_underlying(f.state);
-}
-
-PhysicalPaths get_paths_in_progress(TapeService& ts, StageId const& id)
-{
-  auto st = ts.status(id);
-
-  // after the status update, the stage can result completed
-  if (st.stage().completed_at != 0) {
-    return {};
-  }
-
-  auto& files = st.stage().files;
-
-  // files are sorted by state
-  auto in_progress = std::equal_range(
-      files.begin(), files.end(), File::State::started,
-      [](auto const& e1, auto const& e2) {
-        return to_underlying_state(e1) < to_underlying_state(e2);
-      });
-
-  auto proj = [](File const& file) -> PhysicalPath const& {
-    return file.physical_path;
-  };
-
-  auto const d = std::distance(in_progress.first, in_progress.second);
-  BOOST_ASSERT(d >= 0);
-  PhysicalPaths result{};
-  result.reserve(static_cast<std::size_t>(d));
-  std::move(boost::make_transform_iterator(in_progress.first, proj),
-            boost::make_transform_iterator(in_progress.second, proj),
-            std::back_inserter(result));
-
-  return result;
-}
-
-void remove_duplicates(PhysicalPaths& paths)
-{
-  std::sort(paths.begin(), paths.end());
-  auto last = std::unique(paths.begin(), paths.end());
-  paths.erase(last, paths.end());
-}
-
-} // namespace
-
 InProgressResponse TapeService::in_progress()
 {
   PROFILE_FUNCTION();
-
-  auto const stage_ids = m_db.find_incomplete_stages();
-
-  auto paths = std::transform_reduce(
-      stage_ids.begin(), stage_ids.end(), PhysicalPaths{},
-      [](PhysicalPaths acc, PhysicalPaths other) {
-        acc.reserve(acc.size() + other.size());
-        std::move(other.begin(), other.end(), std::back_inserter(acc));
-        return acc;
-      },
-      [this](StageId const& id) { return get_paths_in_progress(*this, id); });
-
-  remove_duplicates(paths);
-
-  return InProgressResponse{std::move(paths)};
+  // the state of the files is kept up to date by reconcile()
+  return InProgressResponse{m_db.find_files_in_progress()};
 }
 
 InProgressResponse TapeService::in_progress(InProgressRequest req)
@@ -603,8 +597,11 @@ InProgressResponse TapeService::in_progress(InProgressRequest req)
   auto physical_paths = m_db.get_files(File::State::started, req.n_files);
 
   if (req.precise > 0) {
-    std::erase_if(physical_paths, [&](PhysicalPath const& path) {
-      return !ExtendedFileStatus{m_storage, path}.is_in_progress();
+    auto const statuses = probe(m_storage, m_io, physical_paths);
+    std::size_t i{0};
+    std::erase_if(physical_paths, [&](PhysicalPath const&) {
+      ExtendedFileStatus const file_status{statuses, i++};
+      return !(file_status && file_status.is_in_progress());
     });
   }
 
@@ -1,10 +1,13 @@
 #ifndef TAPE_SERVICE_HPP
 #define TAPE_SERVICE_HPP
 
+#include "io_executor.hpp"
+#include "storage_area_resolver.hpp"
 #include "types.hpp"
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <filesystem>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -34,14 +37,20 @@ class File;
 class TapeService
 {
   boost::uuids::random_generator m_uuid_gen;
+  // the uuid generator is not thread-safe and requests are served concurrently
+  std::mutex m_uuid_mutex;
   Configuration const& m_config;
   Database& m_db;
   Storage& m_storage;
+  // built once from the storage areas in the configuration
+  StorageAreaResolver m_resolve;
+  // parallelizes the probes of the storage for the files of a request
+  IoExecutor m_io;
+
+  void reconcile(StageId const& id);
 
  public:
-  TapeService(Configuration const& config, Database& db, Storage& storage)
-      : m_config{config}, m_db(db), m_storage(storage)
-  {}
+  TapeService(Configuration const& config, Database& db, Storage& storage);
 
   StageResponse stage(StageRequest stage_request);
   StatusResponse status(StageId const& id);
@@ -55,6 +64,11 @@ class TapeService
   TakeOverResponse take_over(TakeOverRequest);
   InProgressResponse in_progress();
   InProgressResponse in_progress(InProgressRequest);
+
+  // Bring the state of the files of the incomplete stages, and the timestamps
+  // of the stages, in line with the storage. Called periodically by the
+  // Reconciler, so that status does not need to probe the storage.
+  void reconcile();
 };
 
 } // namespace storm
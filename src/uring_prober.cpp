@@ -0,0 +1,263 @@
+#include "uring_prober.hpp"
+#include "local_storage.hpp"
+#include "profiler.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+namespace storm {
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+[[noreturn]] void throw_errno(int err, char const* what)
+{
+  throw std::system_error(err, std::generic_category(), what);
+}
+
+// the heads and the tails of the rings are shared with the kernel
+unsigned load_acquire(unsigned* p)
+{
+  return std::atomic_ref<unsigned>{*p}.load(std::memory_order_acquire);
+}
+
+void store_release(unsigned* p, unsigned value)
+{
+  std::atomic_ref<unsigned>{*p}.store(value, std::memory_order_release);
+}
+
+template<typename T>
+T* at(void* base, std::size_t offset)
+{
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+void* map(int fd, std::size_t size, off_t offset)
+{
+  auto const p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, offset);
+  if (p == MAP_FAILED) {
+    throw_errno(errno, "cannot map the io_uring rings");
+  }
+  return p;
+}
+
+} // namespace
+
+UringProber::UringProber(unsigned entries)
+{
+  io_uring_params params{};
+  m_fd = io_uring_setup(entries, &params);
+  if (m_fd < 0) {
+    throw_errno(errno, "cannot set up io_uring");
+  }
+
+  try {
+    m_sq_ring_size =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      m_sq_ring_size = m_cq_ring_size =
+          std::max(m_sq_ring_size, m_cq_ring_size);
+    }
+
+    m_sq_ring = map(m_fd, m_sq_ring_size, IORING_OFF_SQ_RING);
+    m_cq_ring =
+        single_mmap ? m_sq_ring : map(m_fd, m_cq_ring_size, IORING_OFF_CQ_RING);
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(map(m_fd, m_sqes_size, IORING_OFF_SQES));
+
+    m_sq_head    = at<unsigned>(m_sq_ring, params.sq_off.head);
+    m_sq_tail    = at<unsigned>(m_sq_ring, params.sq_off.tail);
+    m_sq_array   = at<unsigned>(m_sq_ring, params.sq_off.array);
+    m_sq_mask    = *at<unsigned>(m_sq_ring, params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_cq_head    = at<unsigned>(m_cq_ring, params.cq_off.head);
+    m_cq_tail    = at<unsigned>(m_cq_ring, params.cq_off.tail);
+    m_cqes       = at<io_uring_cqe>(m_cq_ring, params.cq_off.cqes);
+    m_cq_mask    = *at<unsigned>(m_cq_ring, params.cq_off.ring_mask);
+
+    // io_uring_probe is a header followed by a flexible array of ops
+    static_assert(sizeof(io_uring_probe) == 2 * sizeof(io_uring_probe_op));
+    std::vector<io_uring_probe_op> buffer(2 + IORING_OP_LAST);
+    auto const probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (io_uring_register(m_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST)
+        < 0) {
+      throw_errno(errno, "cannot probe the io_uring operations");
+    }
+    auto const supported = [&](unsigned op) {
+      return op <= probe->last_op
+          && (buffer[2 + op].flags & IO_URING_OP_SUPPORTED) != 0;
+    };
+    if (!supported(IORING_OP_STATX)) {
+      throw_errno(ENOSYS, "statx is not supported by io_uring");
+    }
+    m_has_getxattr = supported(IORING_OP_GETXATTR);
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+UringProber::~UringProber()
+{
+  release();
+}
+
+void UringProber::release() noexcept
+{
+  if (m_sqes != nullptr) {
+    ::munmap(m_sqes, m_sqes_size);
+  }
+  if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring) {
+    ::munmap(m_cq_ring, m_cq_ring_size);
+  }
+  if (m_sq_ring != nullptr) {
+    ::munmap(m_sq_ring, m_sq_ring_size);
+  }
+  ::close(m_fd);
+}
+
+// Submit the n requests queued in the submission ring and wait for all of
+// them to complete, storing the result of each at the index given by its
+// user data
+void UringProber::submit_and_wait(unsigned n, std::span<int> results)
+{
+  unsigned submitted{0};
+  unsigned completed{0};
+  int error{0};
+
+  // after a failure, wait anyway for the requests already submitted, which
+  // refer to memory owned by the caller
+  while (completed != (error == 0 ? n : submitted)) {
+    auto const to_submit = error == 0 ? n - submitted : 0;
+    auto const res =
+        io_uring_enter(m_fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+    if (res >= 0) {
+      submitted += static_cast<unsigned>(res);
+    } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      error = errno;
+    }
+
+    auto head       = *m_cq_head;
+    auto const tail = load_acquire(m_cq_tail);
+    for (; head != tail; ++head) {
+      auto const& cqe = m_cqes[head & m_cq_mask];
+      results[cqe.user_data] = cqe.res;
+      ++completed;
+    }
+    store_release(m_cq_head, head);
+  }
+
+  if (error != 0) {
+    throw_errno(error, "cannot submit requests to io_uring");
+  }
+}
+
+void UringProber::probe(std::span<PhysicalPath const> paths,
+                        FileStatuses& result)
+{
+  PROFILE_FUNCTION();
+  constexpr unsigned long long bytes_per_block{512};
+  static constexpr char in_progress_name[] = "user.TSMRecT";
+  static constexpr char on_tape_name[]     = "user.storm.migrated";
+
+  // the requests for a file are a statx and possibly two getxattr, in this
+  // order
+  std::size_t const ops_per_file = m_has_getxattr ? 3 : 1;
+  std::size_t const window       = m_sq_entries / ops_per_file;
+  std::vector<struct statx> stxs(std::min(window, paths.size()));
+  std::vector<int> results(stxs.size() * ops_per_file);
+
+  for (std::size_t first = 0; first < paths.size(); first += window) {
+    auto const n = std::min(window, paths.size() - first);
+
+    // the submission ring is empty, all the previous requests have completed
+    auto tail       = *m_sq_tail;
+    auto const push = [&](std::uint8_t opcode,
+                          std::size_t user_data) -> io_uring_sqe& {
+      auto const index   = tail++ & m_sq_mask;
+      m_sq_array[index] = index;
+      auto& sqe         = m_sqes[index];
+      sqe               = io_uring_sqe{};
+      sqe.opcode        = opcode;
+      sqe.user_data     = user_data;
+      return sqe;
+    };
+
+    for (std::size_t k = 0; k != n; ++k) {
+      auto const path = reinterpret_cast<std::uintptr_t>(paths[first + k].c_str());
+      auto& stat      = push(IORING_OP_STATX, k * ops_per_file);
+      stat.fd         = AT_FDCWD;
+      stat.addr       = path;
+      stat.len        = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_BLOCKS;
+      stat.addr2      = reinterpret_cast<std::uintptr_t>(&stxs[k]);
+      if (m_has_getxattr) {
+        // with no buffer, getxattr returns the size of the value
+        auto& in_progress = push(IORING_OP_GETXATTR, k * ops_per_file + 1);
+        in_progress.addr  = reinterpret_cast<std::uintptr_t>(in_progress_name);
+        in_progress.addr3 = path;
+        auto& on_tape     = push(IORING_OP_GETXATTR, k * ops_per_file + 2);
+        on_tape.addr      = reinterpret_cast<std::uintptr_t>(on_tape_name);
+        on_tape.addr3     = path;
+      }
+    }
+    store_release(m_sq_tail, tail);
+    submit_and_wait(static_cast<unsigned>(n * ops_per_file), results);
+
+    for (std::size_t k = 0; k != n; ++k) {
+      auto const i = first + k;
+      auto const r = std::span{results}.subspan(k * ops_per_file, ops_per_file);
+      if (r[0] < 0) {
+        result.errors[i] = std::make_error_code(std::errc{-r[0]});
+        continue;
+      }
+      auto const& stx   = stxs[k];
+      result.types[i]   = to_file_type(stx.stx_mode);
+      result.sizes[i]   = static_cast<std::size_t>(stx.stx_size);
+      result.is_stub[i] = stx.stx_blocks * bytes_per_block < stx.stx_size;
+
+      if (!m_has_getxattr || !S_ISREG(stx.stx_mode)) {
+        continue;
+      }
+      // a missing xattr, or no support for xattrs, is not an error
+      auto const has_xattr = [&](int res) {
+        if (res < 0 && -res != ENODATA && -res != EOPNOTSUPP) {
+          result.errors[i] = std::make_error_code(std::errc{-res});
+        }
+        return res >= 0;
+      };
+      result.in_progress[i] = has_xattr(r[1]);
+      result.on_tape[i]     = has_xattr(r[2]);
+    }
+  }
+}
+
+} // namespace storm
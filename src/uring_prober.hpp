@@ -0,0 +1,67 @@
+#ifndef STORM_URING_PROBER_HPP
+#define STORM_URING_PROBER_HPP
+
+#include "storage.hpp"
+#include "types.hpp"
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <span>
+
+namespace storm {
+
+// Probe the status of many files at once through io_uring.
+//
+// For each file a statx and, if the kernel supports them, two getxattr
+// requests are queued; a whole window of requests is submitted with a single
+// system call and the completions are reaped together. A prober owns its
+// rings and is not thread-safe, so each thread needs its own.
+class UringProber
+{
+  int m_fd{-1};
+
+  void* m_sq_ring{nullptr};
+  std::size_t m_sq_ring_size{0};
+  void* m_cq_ring{nullptr};
+  std::size_t m_cq_ring_size{0};
+  io_uring_sqe* m_sqes{nullptr};
+  std::size_t m_sqes_size{0};
+
+  unsigned* m_sq_head{nullptr};
+  unsigned* m_sq_tail{nullptr};
+  unsigned* m_sq_array{nullptr};
+  unsigned m_sq_mask{0};
+  unsigned m_sq_entries{0};
+  unsigned* m_cq_head{nullptr};
+  unsigned* m_cq_tail{nullptr};
+  io_uring_cqe* m_cqes{nullptr};
+  unsigned m_cq_mask{0};
+
+  bool m_has_getxattr{false};
+
+  void release() noexcept;
+  void submit_and_wait(unsigned n, std::span<int> results);
+
+ public:
+  // throw std::system_error if io_uring or statx through io_uring are not
+  // supported by the kernel
+  explicit UringProber(unsigned entries = 256);
+  ~UringProber();
+  UringProber(UringProber const&)            = delete;
+  UringProber& operator=(UringProber const&) = delete;
+
+  // whether the xattrs are read too; if not, in_progress and on_tape are left
+  // to the caller
+  bool has_getxattr() const noexcept
+  {
+    return m_has_getxattr;
+  }
+
+  // Fill the statuses of the files, with the same semantics as
+  // LocalStorage::file_statuses. After an exception the prober cannot be used
+  // anymore.
+  void probe(std::span<PhysicalPath const> paths, FileStatuses& result);
+};
+
+} // namespace storm
+
+#endif // STORM_URING_PROBER_HPP
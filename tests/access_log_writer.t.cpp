@@ -0,0 +1,97 @@
+#include <doctest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "access_log_writer.hpp"
+
+namespace storm {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string content(fs::path const& path)
+{
+  std::ifstream is{path};
+  return {std::istreambuf_iterator<char>{is}, {}};
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("AccessLogWriter");
+
+class AccessLogFixture
+{
+ protected:
+  fs::path m_dir{"/tmp/access-log-test"};
+  fs::path m_path{m_dir / "access.log"};
+
+ public:
+  AccessLogFixture()
+  {
+    fs::remove_all(m_dir);
+    fs::create_directories(m_dir);
+  }
+  ~AccessLogFixture()
+  {
+    fs::remove_all(m_dir);
+  }
+};
+
+TEST_CASE_FIXTURE(AccessLogFixture, "The access log lines are all written")
+{
+  std::ostringstream expected;
+  {
+    AccessLogWriter writer{m_path, 1024 * 1024};
+    for (int i = 0; i != 1000; ++i) {
+      auto const line = "line " + std::to_string(i);
+      CHECK(writer.push(line));
+      expected << line << '\n';
+    }
+  }
+  CHECK_EQ(content(m_path), expected.str());
+}
+
+TEST_CASE_FIXTURE(AccessLogFixture,
+                  "An access log line that does not fit is dropped")
+{
+  {
+    AccessLogWriter writer{m_path, 16};
+    CHECK_FALSE(writer.push(std::string(16, 'x')));
+    CHECK(writer.push("short"));
+  }
+  CHECK_EQ(content(m_path), "short\n");
+}
+
+TEST_CASE_FIXTURE(AccessLogFixture, "The access log is reopened on request")
+{
+  using namespace std::chrono_literals;
+  auto const rotated = m_dir / "access.log.1";
+  {
+    AccessLogWriter writer{m_path, 1024};
+    writer.push("before");
+    while (content(m_path).empty()) {
+      std::this_thread::sleep_for(1ms);
+    }
+    fs::rename(m_path, rotated);
+    AccessLogWriter::request_reopen();
+    writer.push("after");
+  }
+  CHECK_EQ(content(rotated), "before\n");
+  CHECK_EQ(content(m_path), "after\n");
+}
+
+TEST_CASE("An access log that cannot be opened is an error")
+{
+  CHECK_THROWS_AS(AccessLogWriter("/nonexistent/access.log", 1024),
+                  std::system_error);
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
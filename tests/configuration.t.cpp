@@ -684,4 +684,390 @@ mirror-mode: on
   CHECK_EQ(config.mirror_mode, true);
 }
 
+TEST_CASE("If the concurrency is not specified, it defaults to 1")
+{
+  auto constexpr conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+  std::istringstream is{conf};
+  auto config = storm::load_configuration(is);
+  CHECK_EQ(config.concurrency, 1);
+}
+
+TEST_CASE("If present, the concurrency cannot be empty")
+{
+  auto constexpr conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+concurrency:
+)";
+
+  std::istringstream is{conf};
+  CHECK_THROWS_WITH_AS(storm::load_configuration(is), "concurrency is null",
+                       std::runtime_error);
+}
+
+TEST_CASE("The concurrency is an integer between 1 and 256 included")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  for (int i : {1, 8, 256}) {
+    auto conf = sa_conf + fmt::format("concurrency: {}\n", i);
+    std::istringstream is{conf};
+    auto config = storm::load_configuration(is);
+    CHECK_EQ(config.concurrency, i);
+  }
+
+  for (auto s : {"0", "-1", "257", "3.14", "foo"}) {
+    auto conf = sa_conf + fmt::format("concurrency: {}\n", s);
+    std::istringstream is{conf};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is),
+                         "invalid 'concurrency' entry in configuration",
+                         std::runtime_error);
+  }
+}
+
+TEST_CASE("If the io-threads entry is not specified, it defaults to 8")
+{
+  auto constexpr conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+  std::istringstream is{conf};
+  auto config = storm::load_configuration(is);
+  CHECK_EQ(config.io_threads, 8);
+}
+
+TEST_CASE("The io-threads entry is an integer between 0 and 256 included")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  for (int i : {0, 1, 256}) {
+    auto conf = sa_conf + fmt::format("io-threads: {}\n", i);
+    std::istringstream is{conf};
+    auto config = storm::load_configuration(is);
+    CHECK_EQ(config.io_threads, i);
+  }
+
+  for (auto s : {"", "-1", "257", "3.14", "foo"}) {
+    auto conf = sa_conf + fmt::format("io-threads: {}\n", s);
+    std::istringstream is{conf};
+    CHECK_THROWS_AS(storm::load_configuration(is), std::runtime_error);
+  }
+}
+
+TEST_CASE("If the database entry is not specified, the defaults are used")
+{
+  auto constexpr conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+  std::istringstream is{conf};
+  auto const config = storm::load_configuration(is);
+  auto const& db    = config.database;
+  CHECK_EQ(db.path, storm::Path{"storm-tape.sqlite"});
+  CHECK_EQ(db.journal_mode, "wal");
+  CHECK_EQ(db.synchronous, "normal");
+  CHECK_EQ(db.mmap_size, 0);
+  CHECK_EQ(db.cache_size, -2'000);
+  CHECK_EQ(db.busy_timeout, 60'000);
+}
+
+TEST_CASE("The database settings can be configured")
+{
+  auto constexpr conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+database:
+  path: /var/lib/storm-tape/db.sqlite
+  journal-mode: DELETE
+  synchronous: full
+  mmap-size: 268435456
+  cache-size: -65536
+  busy-timeout: 5000
+)";
+  std::istringstream is{conf};
+  auto const config = storm::load_configuration(is);
+  auto const& db    = config.database;
+  CHECK_EQ(db.path, storm::Path{"/var/lib/storm-tape/db.sqlite"});
+  CHECK_EQ(db.journal_mode, "delete");
+  CHECK_EQ(db.synchronous, "full");
+  CHECK_EQ(db.mmap_size, 268'435'456);
+  CHECK_EQ(db.cache_size, -65'536);
+  CHECK_EQ(db.busy_timeout, 5'000);
+}
+
+TEST_CASE("Invalid database settings are rejected")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+database:
+)";
+
+  // clang-format off
+  std::pair<char const*, char const*> const cases[] = {
+    {"  path:\n",                 "database.path is null"},
+    {"  journal-mode: fast\n",    "invalid 'database.journal-mode' entry in configuration"},
+    {"  synchronous: 1\n",        "invalid 'database.synchronous' entry in configuration"},
+    {"  mmap-size: -1\n",         "invalid 'database.mmap-size' entry in configuration"},
+    {"  cache-size: 3.14\n",      "invalid 'database.cache-size' entry in configuration"},
+    {"  busy-timeout: -1\n",      "invalid 'database.busy-timeout' entry in configuration"},
+    {"  busy-timeout:\n",         "database.busy-timeout is null"}
+  };
+  // clang-format on
+
+  for (auto const& [entry, message] : cases) {
+    std::istringstream is{sa_conf + std::string{entry}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is), message,
+                         std::runtime_error);
+  }
+
+  {
+    std::istringstream is{sa_conf + std::string{"  - path\n"}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is),
+                         "invalid 'database' entry in configuration",
+                         std::runtime_error);
+  }
+}
+
+TEST_CASE("The locality cache can be configured")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  {
+    std::istringstream is{sa_conf};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.locality_cache.capacity, 100'000);
+    CHECK_EQ(config.locality_cache.ttl, 10);
+    CHECK_FALSE(config.locality_cache.inotify);
+  }
+
+  {
+    std::istringstream is{sa_conf + std::string{R"(locality-cache:
+  capacity: 500
+  ttl: 0
+  inotify: true
+)"}};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.locality_cache.capacity, 500);
+    CHECK_EQ(config.locality_cache.ttl, 0);
+    CHECK(config.locality_cache.inotify);
+  }
+
+  // clang-format off
+  std::pair<char const*, char const*> const cases[] = {
+    {"locality-cache: 10\n",               "invalid 'locality-cache' entry in configuration"},
+    {"locality-cache:\n  capacity: -1\n",  "invalid 'locality-cache.capacity' entry in configuration"},
+    {"locality-cache:\n  ttl: 1d\n",       "invalid 'locality-cache.ttl' entry in configuration"},
+    {"locality-cache:\n  inotify: maybe\n", "invalid 'locality-cache.inotify' entry in configuration"},
+    {"locality-cache:\n  inotify:\n",      "locality-cache.inotify is null"}
+  };
+  // clang-format on
+
+  for (auto const& [entry, message] : cases) {
+    std::istringstream is{sa_conf + std::string{entry}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is), message,
+                         std::runtime_error);
+  }
+}
+
+TEST_CASE("The request limits can be configured")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  {
+    std::istringstream is{sa_conf};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.limits.max_files, 100'000);
+    CHECK_EQ(config.limits.max_body_size, 64 * 1024 * 1024);
+  }
+
+  {
+    std::istringstream is{sa_conf + std::string{R"(limits:
+  max-files: 10
+  max-body-size: 1000
+)"}};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.limits.max_files, 10);
+    CHECK_EQ(config.limits.max_body_size, 1000);
+  }
+
+  // clang-format off
+  std::pair<char const*, char const*> const cases[] = {
+    {"limits: 10\n",                   "invalid 'limits' entry in configuration"},
+    {"limits:\n  max-files: 0\n",      "invalid 'limits.max-files' entry in configuration"},
+    {"limits:\n  max-files: -1\n",     "invalid 'limits.max-files' entry in configuration"},
+    {"limits:\n  max-body-size: 1M\n", "invalid 'limits.max-body-size' entry in configuration"},
+    {"limits:\n  max-body-size: -1\n", "invalid 'limits.max-body-size' entry in configuration"},
+    {"limits:\n  max-files:\n",        "limits.max-files is null"}
+  };
+  // clang-format on
+
+  for (auto const& [entry, message] : cases) {
+    std::istringstream is{sa_conf + std::string{entry}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is), message,
+                         std::runtime_error);
+  }
+}
+
+TEST_CASE("The reconciler can be configured")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  {
+    std::istringstream is{sa_conf};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.reconciler.interval, 10);
+    CHECK_EQ(config.reconciler.batch_size, 1'000);
+  }
+
+  {
+    std::istringstream is{sa_conf + std::string{R"(reconciler:
+  interval: 60
+  batch-size: 50
+)"}};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.reconciler.interval, 60);
+    CHECK_EQ(config.reconciler.batch_size, 50);
+  }
+
+  // clang-format off
+  std::pair<char const*, char const*> const cases[] = {
+    {"reconciler: 10\n",               "invalid 'reconciler' entry in configuration"},
+    {"reconciler:\n  interval: 0\n",   "invalid 'reconciler.interval' entry in configuration"},
+    {"reconciler:\n  batch-size: 0\n", "invalid 'reconciler.batch-size' entry in configuration"},
+    {"reconciler:\n  interval:\n",     "reconciler.interval is null"}
+  };
+  // clang-format on
+
+  for (auto const& [entry, message] : cases) {
+    std::istringstream is{sa_conf + std::string{entry}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is), message,
+                         std::runtime_error);
+  }
+}
+
+TEST_CASE("The profiling can be configured")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  {
+    std::istringstream is{sa_conf};
+    auto const config = storm::load_configuration(is);
+    CHECK(config.profiling.enabled);
+    CHECK_EQ(config.profiling.sampling, 1);
+  }
+
+  {
+    std::istringstream is{sa_conf + std::string{R"(profiling:
+  enabled: false
+  sampling: 100
+)"}};
+    auto const config = storm::load_configuration(is);
+    CHECK_FALSE(config.profiling.enabled);
+    CHECK_EQ(config.profiling.sampling, 100);
+  }
+
+  // clang-format off
+  std::pair<char const*, char const*> const cases[] = {
+    {"profiling: 10\n",                "invalid 'profiling' entry in configuration"},
+    {"profiling:\n  enabled: maybe\n", "invalid 'profiling.enabled' entry in configuration"},
+    {"profiling:\n  sampling: 0\n",    "invalid 'profiling.sampling' entry in configuration"},
+    {"profiling:\n  enabled:\n",       "profiling.enabled is null"}
+  };
+  // clang-format on
+
+  for (auto const& [entry, message] : cases) {
+    std::istringstream is{sa_conf + std::string{entry}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is), message,
+                         std::runtime_error);
+  }
+}
+
+TEST_CASE("The access log can be configured")
+{
+  auto constexpr sa_conf = R"(
+storage-areas:
+- name: test
+  root: /tmp
+  access-point: /someexp
+)";
+
+  {
+    std::istringstream is{sa_conf};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.access_log.path, storm::Path{"-"});
+    CHECK_EQ(config.access_log.buffer_size, 4 * 1024 * 1024);
+  }
+
+  {
+    std::istringstream is{sa_conf + std::string{R"(access-log:
+  path: /var/log/storm-tape/access.log
+  buffer-size: 1048576
+)"}};
+    auto const config = storm::load_configuration(is);
+    CHECK_EQ(config.access_log.path,
+             storm::Path{"/var/log/storm-tape/access.log"});
+    CHECK_EQ(config.access_log.buffer_size, 1'048'576);
+  }
+
+  // clang-format off
+  std::pair<char const*, char const*> const cases[] = {
+    {"access-log: 10\n",                 "invalid 'access-log' entry in configuration"},
+    {"access-log:\n  buffer-size: 10\n", "invalid 'access-log.buffer-size' entry in configuration"},
+    {"access-log:\n  path:\n",           "access-log.path is null"}
+  };
+  // clang-format on
+
+  for (auto const& [entry, message] : cases) {
+    std::istringstream is{sa_conf + std::string{entry}};
+    CHECK_THROWS_WITH_AS(storm::load_configuration(is), message,
+                         std::runtime_error);
+  }
+}
+
 TEST_SUITE_END;
@@ -0,0 +1,357 @@
+#include <doctest.h>
+#include <fmt/core.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <thread>
+
+#include "database.hpp"
+#include "database_cache.hpp"
+#include "fixture.t.hpp"
+#include "sql_queries.hpp"
+#include "stage_request.hpp"
+
+namespace storm {
+
+TEST_SUITE_BEGIN("Database");
+
+static Files make_files(std::size_t n, File::State state = File::State::submitted)
+{
+  Files files;
+  files.reserve(n);
+  for (std::size_t i = 0; i != n; ++i) {
+    auto const path = fmt::format("/tmp/db-test/file{:06}", i);
+    files.push_back(File{LogicalPath{path}, PhysicalPath{path}, state});
+  }
+  return files;
+}
+
+TEST_CASE_FIXTURE(TestFixture, "A stage with many files is inserted in batches")
+{
+  // more files than fit in a single insert batch
+  auto const n_files = std::size_t{25'001};
+  StageRequest const request{make_files(n_files), 42, 0, 0};
+
+  REQUIRE(m_db.insert("many", request));
+
+  auto const maybe_stage = m_db.find("many");
+  REQUIRE(maybe_stage.has_value());
+  auto const& stage = *maybe_stage;
+  CHECK_EQ(stage.created_at, 42);
+  REQUIRE_EQ(stage.files.size(), n_files);
+  CHECK(std::equal(stage.files.begin(), stage.files.end(),
+                   request.files.begin(), [](File const& a, File const& b) {
+                     return a.logical_path == b.logical_path
+                         && a.physical_path == b.physical_path
+                         && a.state == b.state;
+                   }));
+  CHECK_EQ(m_db.count_files(File::State::submitted), n_files);
+}
+
+TEST_CASE_FIXTURE(TestFixture, "A stage with no files can be inserted")
+{
+  REQUIRE(m_db.insert("empty", StageRequest{{}, 42, 0, 0}));
+  auto const maybe_stage = m_db.find("empty");
+  REQUIRE(maybe_stage.has_value());
+  CHECK(maybe_stage->files.empty());
+}
+
+TEST_CASE_FIXTURE(TestFixture,
+                  "A state transition is applied to a set of physical paths")
+{
+  auto const files = make_files(10);
+  REQUIRE(m_db.insert("s1", StageRequest{files, 42, 0, 0}));
+  REQUIRE(m_db.insert("s2", StageRequest{files, 42, 0, 0}));
+
+  PhysicalPaths started{files[0].physical_path, files[1].physical_path,
+                        files[2].physical_path};
+  REQUIRE(m_db.update(started, File::State::started, 100));
+  CHECK_EQ(m_db.count_files(File::State::started), 3);
+  CHECK_EQ(m_db.count_files(File::State::submitted), 7);
+
+  // only submitted and started files can be finished
+  PhysicalPaths completed{files[0].physical_path, files[5].physical_path};
+  REQUIRE(m_db.update(completed, File::State::completed, 200));
+  REQUIRE(m_db.update(started, File::State::failed, 300));
+
+  for (auto const* id : {"s1", "s2"}) {
+    auto const stage = m_db.find(id);
+    REQUIRE(stage.has_value());
+    auto const& f = stage->files;
+    CHECK_EQ(f[0].state, File::State::completed);
+    CHECK_EQ(f[0].started_at, 100);
+    CHECK_EQ(f[0].finished_at, 200);
+    CHECK_EQ(f[1].state, File::State::failed);
+    CHECK_EQ(f[1].started_at, 100);
+    CHECK_EQ(f[1].finished_at, 300);
+    CHECK_EQ(f[5].state, File::State::completed);
+    CHECK_EQ(f[5].started_at, 200);
+    CHECK_EQ(f[9].state, File::State::submitted);
+  }
+}
+
+TEST_CASE_FIXTURE(TestFixture,
+                  "A state transition is applied to a set of logical paths")
+{
+  auto const files = make_files(10);
+  REQUIRE(m_db.insert("s1", StageRequest{files, 42, 0, 0}));
+  REQUIRE(m_db.insert("s2", StageRequest{files, 42, 0, 0}));
+
+  LogicalPaths cancelled{files[3].logical_path, files[4].logical_path,
+                         files[4].logical_path};
+  REQUIRE(m_db.update("s1", cancelled, File::State::cancelled, 100));
+
+  auto const s1 = m_db.find("s1");
+  auto const s2 = m_db.find("s2");
+  REQUIRE(s1.has_value());
+  REQUIRE(s2.has_value());
+  CHECK_EQ(s1->files[3].state, File::State::cancelled);
+  CHECK_EQ(s1->files[4].state, File::State::cancelled);
+  CHECK_EQ(s1->files[4].finished_at, 100);
+  CHECK_EQ(s1->files[5].state, File::State::submitted);
+  CHECK(std::all_of(s2->files.begin(), s2->files.end(), [](File const& f) {
+    return f.state == File::State::submitted;
+  }));
+}
+
+TEST_CASE_FIXTURE(TestFixture, "The schema is migrated to the latest version")
+{
+  auto const latest = static_cast<int>(sql::Schema::MIGRATIONS.size());
+  CHECK_EQ(m_db.schema_version(), latest);
+
+  // migrating an up-to-date database is a no-op
+  auto pool = make_sqlite_pool(1, {.path = DB_NAME});
+  SociDatabase db{*pool};
+  CHECK_EQ(db.schema_version(), latest);
+}
+
+TEST_CASE_FIXTURE(TestFixture,
+                  "The path counters follow inserts, updates and erasures")
+{
+  auto const files = make_files(10);
+  REQUIRE(m_db.insert("s1", StageRequest{files, 42, 0, 0}));
+  REQUIRE(m_db.insert("s2", StageRequest{{files[0], files[1]}, 42, 0, 0}));
+  CHECK_EQ(m_db.count_files(File::State::submitted), 10);
+
+  // a path in s1 and s2 is counted once per state
+  REQUIRE(m_db.update("s1", files[0].logical_path, File::State::started, 100));
+  CHECK_EQ(m_db.count_files(File::State::submitted), 10);
+  CHECK_EQ(m_db.count_files(File::State::started), 1);
+  REQUIRE(m_db.update(PhysicalPaths{files[0].physical_path},
+                      File::State::completed, 200));
+  CHECK_EQ(m_db.count_files(File::State::submitted), 9);
+  CHECK_EQ(m_db.count_files(File::State::started), 0);
+  CHECK_EQ(m_db.count_files(File::State::completed), 1);
+
+  REQUIRE(m_db.erase("s1"));
+  CHECK_EQ(m_db.count_files(File::State::submitted), 1);
+  CHECK_EQ(m_db.count_files(File::State::completed), 1);
+  REQUIRE(m_db.erase("s2"));
+  CHECK_EQ(m_db.count_files(File::State::submitted), 0);
+  CHECK_EQ(m_db.count_files(File::State::completed), 0);
+}
+
+TEST_CASE_FIXTURE(TestFixture, "The path counters are rebuilt at startup")
+{
+  REQUIRE(m_db.insert("s1", StageRequest{make_files(10), 42, 0, 0}));
+  {
+    soci::session sql{soci::sqlite3, fmt::format("db={}", DB_NAME)};
+    sql << "UPDATE StateCount SET n_paths = 1000";
+  }
+  CHECK_EQ(m_db.count_files(File::State::submitted), 1000);
+
+  auto pool = make_sqlite_pool(1, {.path = DB_NAME});
+  SociDatabase db{*pool};
+  CHECK_EQ(db.count_files(File::State::submitted), 10);
+  CHECK_EQ(db.count_files(File::State::started), 0);
+}
+
+static void check_same_stage(Database const& db1, Database const& db2,
+                             StageId const& id)
+{
+  auto const s1 = db1.find(id);
+  auto const s2 = db2.find(id);
+  REQUIRE_EQ(s1.has_value(), s2.has_value());
+  if (!s1.has_value()) {
+    return;
+  }
+  CHECK_EQ(s1->created_at, s2->created_at);
+  CHECK_EQ(s1->started_at, s2->started_at);
+  CHECK_EQ(s1->completed_at, s2->completed_at);
+  REQUIRE_EQ(s1->files.size(), s2->files.size());
+  for (std::size_t i = 0; i != s1->files.size(); ++i) {
+    auto const& f1 = s1->files[i];
+    auto const& f2 = s2->files[i];
+    CHECK_EQ(f1.logical_path, f2.logical_path);
+    CHECK_EQ(f1.physical_path, f2.physical_path);
+    CHECK_EQ(f1.state, f2.state);
+    CHECK_EQ(f1.started_at, f2.started_at);
+    CHECK_EQ(f1.finished_at, f2.finished_at);
+  }
+}
+
+static void check_same_counts(Database const& db1, Database const& db2)
+{
+  for (auto state : {File::State::submitted, File::State::started,
+                     File::State::completed, File::State::failed,
+                     File::State::cancelled}) {
+    CHECK_EQ(db1.count_files(state), db2.count_files(state));
+    auto p1 = db1.get_files(state, 1'000);
+    auto p2 = db2.get_files(state, 1'000);
+    std::sort(p1.begin(), p1.end());
+    std::sort(p2.begin(), p2.end());
+    CHECK_EQ(p1, p2);
+  }
+  auto p1 = db1.find_files_in_progress();
+  auto p2 = db2.find_files_in_progress();
+  std::sort(p1.begin(), p1.end());
+  std::sort(p2.begin(), p2.end());
+  CHECK_EQ(p1, p2);
+}
+
+TEST_CASE_FIXTURE(TestFixture, "The cache is consistent with the database")
+{
+  auto const files = make_files(10);
+  // a stage inserted before the creation of the cache is loaded at startup
+  REQUIRE(m_db.insert("s1", StageRequest{files, 42, 0, 0}));
+
+  CachingDatabase cache{m_db};
+  REQUIRE(cache.insert("s2", StageRequest{files, 43, 0, 0}));
+  REQUIRE(cache.insert(
+      "s3", StageRequest{{files.begin(), files.begin() + 3}, 44, 0, 0}));
+
+  auto check = [&] {
+    for (auto const* id : {"s1", "s2", "s3"}) {
+      check_same_stage(cache, m_db, id);
+    }
+    check_same_counts(cache, m_db);
+  };
+  check();
+
+  PhysicalPaths started{files[0].physical_path, files[1].physical_path,
+                        files[7].physical_path};
+  REQUIRE(cache.update(started, File::State::started, 100));
+  check();
+  CHECK_EQ(cache.find_files_in_progress(), started);
+
+  REQUIRE(cache.update(files[7].physical_path, File::State::completed, 150));
+  check();
+
+  LogicalPaths cancelled{files[1].logical_path, files[2].logical_path};
+  REQUIRE(cache.update("s2", cancelled, File::State::cancelled, 200));
+  check();
+
+  std::pair<PhysicalPath, File::State> path_states[] = {
+      {files[0].physical_path, File::State::completed},
+      {files[1].physical_path, File::State::failed},
+      {files[2].physical_path, File::State::completed}};
+  REQUIRE(cache.update(StageUpdate{StageEntity{"s3", 44, 100, 300},
+                                   path_states, 300}));
+  check();
+
+  // s3 is now complete, so it is not cached anymore
+  auto const incomplete = cache.find_incomplete_stages();
+  CHECK_EQ(incomplete, std::vector<StageId>{"s1", "s2"});
+
+  REQUIRE(cache.erase("s1"));
+  check();
+  CHECK_FALSE(cache.find("s1").has_value());
+  CHECK_FALSE(cache.erase("s1"));
+}
+
+namespace {
+
+// a database whose inserts, once armed, wait for the test to release them
+class GatedDatabase : public SociDatabase
+{
+  bool m_armed{false};
+  std::promise<void> m_entered;
+  std::promise<void> m_released;
+
+ public:
+  using SociDatabase::SociDatabase;
+
+  bool released_in_time{false};
+
+  std::future<void> arm()
+  {
+    m_armed = true;
+    return m_entered.get_future();
+  }
+
+  void release()
+  {
+    m_released.set_value();
+  }
+
+  bool insert(StageId const& id, StageRequest const& stage) override
+  {
+    if (m_armed) {
+      m_entered.set_value();
+      // do not wait forever, so that a reader blocked by the insert makes the
+      // test fail instead of hang
+      auto const status =
+          m_released.get_future().wait_for(std::chrono::seconds{10});
+      released_in_time = status == std::future_status::ready;
+    }
+    return SociDatabase::insert(id, stage);
+  }
+};
+
+class GatedFixture
+{
+  std::unique_ptr<soci::connection_pool> m_pool;
+
+ protected:
+  GatedDatabase m_db;
+
+ public:
+  GatedFixture()
+      : m_pool{make_sqlite_pool(2, {.path = DB_NAME})}
+      , m_db{*m_pool}
+  {}
+
+  ~GatedFixture()
+  {
+    std::filesystem::remove(DB_NAME);
+  }
+};
+
+} // namespace
+
+TEST_CASE_FIXTURE(GatedFixture,
+                  "The cache can be queried while a large stage is inserted")
+{
+  auto const files = make_files(25'001);
+  REQUIRE(m_db.insert("s1", StageRequest{{files.begin(), files.begin() + 10},
+                                         42, 0, 0}));
+
+  CachingDatabase cache{m_db};
+  auto entered = m_db.arm();
+  bool inserted{false};
+  std::jthread writer{
+      [&] { inserted = cache.insert("s2", StageRequest{files, 43, 0, 0}); }};
+
+  // the insert is now stuck in the underlying database, but the cache still
+  // answers, without the new stage
+  entered.wait();
+  CHECK_EQ(cache.count_files(File::State::submitted), 10);
+  CHECK_EQ(cache.get_files(File::State::submitted, 5).size(), 5);
+  CHECK(cache.find_files_in_progress().empty());
+  auto const s1 = cache.find("s1");
+  REQUIRE(s1.has_value());
+  CHECK_EQ(s1->files.size(), 10);
+  m_db.release();
+  writer.join();
+
+  CHECK(m_db.released_in_time);
+  REQUIRE(inserted);
+  CHECK_EQ(cache.count_files(File::State::submitted), files.size());
+  REQUIRE(cache.find("s2").has_value());
+  CHECK_EQ(cache.find("s2")->files.size(), files.size());
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
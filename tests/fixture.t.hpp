@@ -2,6 +2,7 @@
 #include <soci/sqlite3/soci-sqlite3.h>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 
 #include "configuration.hpp"
 #include "database_soci.hpp"
@@ -24,31 +25,36 @@ storage-areas:
 )";
 }
 
-class TestFixture
+// the storage can be replaced, e.g. to inject failures
+template<class S>
+class BasicTestFixture
 {
-  soci::session m_sql;
+  std::unique_ptr<soci::connection_pool> m_pool;
   storm::Configuration m_config;
-  storm::LocalStorage m_storage;
+  S m_storage;
 
  protected:
   storm::SociDatabase m_db;
   storm::TapeService m_service;
 
  public:
-  TestFixture()
-      : m_sql{soci::sqlite3, DB_NAME}
+  BasicTestFixture()
+      : m_pool{storm::make_sqlite_pool(1, {.path = DB_NAME})}
       , m_config{storm::load_configuration([&]() {
         make_dummy_config();
         return DUMMY_CONFIG_PATH;
       }())}
-      , m_db{m_sql}
+      , m_db{*m_pool}
       , m_service{m_config, m_db, m_storage}
   {}
 
-  ~TestFixture()
+  ~BasicTestFixture()
   {
     std::filesystem::remove(DB_NAME);
     std::filesystem::remove(DUMMY_CONFIG_PATH);
   }
 };
+
+using TestFixture = BasicTestFixture<storm::LocalStorage>;
+
 } // namespace storm
\ No newline at end of file
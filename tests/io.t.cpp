@@ -1,4 +1,9 @@
 #include "io.hpp"
+#include "configuration.hpp"
+#include "in_progress_response.hpp"
+#include "status_response.hpp"
+#include "takeover_response.hpp"
+#include <crow/http_response.h>
 #include <crow/query_string.h>
 #include <doctest.h>
 
@@ -109,4 +114,88 @@ TEST_CASE("An InProgressRequest accepts an `n > 0` and a `precise >= 0`, both "
   }
 }
 
+TEST_CASE("The members of a request body that are not needed are ignored")
+{
+  auto const files = storm::from_json(
+      R"({"files":[{"path":"/tmp//a","diskLifetime":1,"x":{"y":[1,{}]}},)"
+      R"({"targetAttributes":[],"path":"/tmp/b"}],"targetLifetime":null})",
+      storm::StageRequest::tag);
+  REQUIRE_EQ(files.size(), 2);
+  CHECK_EQ(files[0].logical_path, storm::LogicalPath{"/tmp/a"});
+  CHECK_EQ(files[1].logical_path, storm::LogicalPath{"/tmp/b"});
+
+  // "paths" takes precedence over "files", even if the latter is malformed
+  auto const paths = storm::from_json(R"({"files":["/tmp/a"],"paths":["/tmp/c"]})",
+                                      storm::CancelRequest::tag);
+  REQUIRE_EQ(paths.size(), 1);
+  CHECK_EQ(paths[0], storm::LogicalPath{"/tmp/c"});
+
+  CHECK_THROWS_AS(
+      storm::from_json(R"({"files":[{"other":"/tmp/a"}]})", storm::StageRequest::tag),
+      storm::BadRequest);
+  CHECK_THROWS_AS(storm::from_json(R"(["/tmp/a"])", storm::CancelRequest::tag),
+                  storm::BadRequest);
+}
+
+TEST_CASE("The size of a request body is limited")
+{
+  storm::RequestLimits limits;
+  limits.max_files = 2;
+
+  CHECK_EQ(storm::from_json(R"({"paths":["/a","/b"]})",
+                            storm::ArchiveInfoRequest::tag, limits)
+               .size(),
+           2);
+  CHECK_THROWS_AS(storm::from_json(R"({"paths":["/a","/b","/c"]})",
+                                   storm::ArchiveInfoRequest::tag, limits),
+                  storm::PayloadTooLarge);
+  CHECK_THROWS_AS(
+      storm::from_json(R"({"files":[{"path":"/a"},{"path":"/b"},{"path":"/c"}]})",
+                       storm::StageRequest::tag, limits),
+      storm::PayloadTooLarge);
+
+  limits.max_body_size = 16;
+  CHECK_THROWS_AS(storm::from_json(R"({"paths":["/a","/b"]})",
+                                   storm::ArchiveInfoRequest::tag, limits),
+                  storm::PayloadTooLarge);
+}
+
+TEST_CASE("The text responses have one line per path")
+{
+  storm::PhysicalPaths const paths{storm::PhysicalPath{"/tmp/a"},
+                                   storm::PhysicalPath{"/tmp/b/c"}};
+
+  auto const takeover = to_crow_response(storm::TakeOverResponse{paths});
+  CHECK_EQ(takeover.body, "unused /tmp/a\nunused /tmp/b/c\n");
+
+  auto const in_progress = to_crow_response(storm::InProgressResponse{paths});
+  CHECK_EQ(in_progress.body, "/tmp/a\n/tmp/b/c\n");
+
+  CHECK(to_crow_response(storm::InProgressResponse{}).body.empty());
+}
+
+TEST_CASE("A StatusResponse is serialized as JSON")
+{
+  using storm::File;
+
+  storm::StageRequest stage{
+      storm::Files{File{storm::LogicalPath{"/a"}, storm::PhysicalPath{"/s/a"},
+                        File::State::completed},
+                   File{storm::LogicalPath{"/b \"c\"\n"},
+                        storm::PhysicalPath{"/s/b"}, File::State::started}},
+      1, 2, 0};
+
+  auto const response =
+      to_crow_response(storm::StatusResponse{"0123", std::move(stage)});
+  CHECK_EQ(response.body,
+           R"({"id":"0123","createdAt":1,"startedAt":2,"completedAt":0,)"
+           R"("files":[{"path":"/a","state":"COMPLETED"},)"
+           R"({"path":"/b \"c\"\n","state":"STARTED"}]})");
+
+  auto const empty = to_crow_response(storm::StatusResponse{"0123", {}});
+  CHECK_EQ(empty.body,
+           R"({"id":"0123","createdAt":0,"startedAt":0,"completedAt":0,)"
+           R"("files":[]})");
+}
+
 TEST_SUITE_END;
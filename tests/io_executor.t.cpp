@@ -0,0 +1,112 @@
+#include <doctest.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <latch>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "io_executor.hpp"
+
+namespace storm {
+
+TEST_SUITE_BEGIN("IoExecutor");
+
+TEST_CASE("Each index is visited exactly once")
+{
+  for (std::size_t n_threads : std::array<std::size_t, 3>{0, 1, 4}) {
+    IoExecutor io{n_threads};
+    CHECK_EQ(io.size(), n_threads);
+    for (std::size_t n : std::array<std::size_t, 4>{0, 1, 3, 1000}) {
+      std::vector<int> visits(n);
+      io.for_each_index(n, [&](std::size_t i) { ++visits[i]; });
+      CHECK(std::all_of(visits.begin(), visits.end(),
+                        [](int v) { return v == 1; }));
+    }
+  }
+}
+
+TEST_CASE("The work is spread over multiple threads")
+{
+  IoExecutor io{4};
+  std::mutex mutex;
+  std::set<std::thread::id> ids;
+  io.for_each_index(100, [&](std::size_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    std::lock_guard lock{mutex};
+    ids.insert(std::this_thread::get_id());
+  });
+  CHECK_GT(ids.size(), 1);
+}
+
+TEST_CASE("An exception is propagated to the caller")
+{
+  IoExecutor io{4};
+  std::atomic<int> count{0};
+  CHECK_THROWS_AS(io.for_each_index(100,
+                                    [&](std::size_t i) {
+                                      ++count;
+                                      if (i == 10) {
+                                        throw std::runtime_error{"boom"};
+                                      }
+                                    }),
+                  std::runtime_error);
+  CHECK_LE(count.load(), 100);
+
+  // the executor is still usable
+  std::atomic<std::size_t> sum{0};
+  io.for_each_index(10, [&](std::size_t i) { sum += i; });
+  CHECK_EQ(sum.load(), 45);
+}
+
+TEST_CASE("Concurrent callers share the executor")
+{
+  IoExecutor io{2};
+  std::atomic<std::size_t> sum{0};
+  {
+    std::vector<std::jthread> callers;
+    for (int t = 0; t != 4; ++t) {
+      callers.emplace_back([&] {
+        io.for_each_index(100, [&](std::size_t i) { sum += i; });
+      });
+    }
+  }
+  CHECK_EQ(sum.load(), 4 * 4950);
+}
+
+TEST_CASE("A caller does not wait for its helpers still in the queue")
+{
+  IoExecutor io{1};
+
+  // keep the only thread of the pool busy
+  std::latch entered{2};
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::jthread blocker{[&] {
+    io.for_each_index(2, [&](std::size_t) {
+      entered.count_down();
+      released.wait();
+    });
+  }};
+  entered.wait();
+
+  // the helper of this call is queued behind the blocked one, so all the
+  // indexes are processed by the caller
+  std::atomic<std::size_t> sum{0};
+  auto done = std::async(std::launch::async, [&] {
+    io.for_each_index(4, [&](std::size_t i) { sum += i; });
+  });
+  CHECK_EQ(done.wait_for(std::chrono::seconds{10}), std::future_status::ready);
+  release.set_value();
+  done.get();
+  CHECK_EQ(sum.load(), 6);
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
@@ -0,0 +1,175 @@
+#include <doctest.h>
+#include <fmt/core.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "extended_attributes.hpp"
+#include "local_storage.hpp"
+#include "locality_cache.hpp"
+#include "storage_cache.hpp"
+
+namespace storm {
+
+TEST_SUITE_BEGIN("LocalityCache");
+
+using namespace std::chrono_literals;
+
+namespace {
+
+FileStatus make_status(std::size_t size)
+{
+  FileStatus status;
+  status.type    = fs::file_type::regular;
+  status.size    = size;
+  status.on_tape = true;
+  return status;
+}
+
+// count the files queried on the underlying storage
+struct CountingStorage : LocalStorage
+{
+  std::size_t n_queried{0};
+  FileStatuses file_statuses(std::span<PhysicalPath const> paths) override
+  {
+    n_queried += paths.size();
+    return LocalStorage::file_statuses(paths);
+  }
+};
+
+class CacheFixture
+{
+ protected:
+  fs::path m_dir{"/tmp/locality-cache-test"};
+  PhysicalPaths m_paths{PhysicalPath{m_dir / "a"}, PhysicalPath{m_dir / "b"}};
+
+ public:
+  CacheFixture()
+  {
+    fs::create_directories(m_dir);
+    for (auto const& path : m_paths) {
+      std::ofstream{path} << "content";
+    }
+  }
+  ~CacheFixture()
+  {
+    fs::remove_all(m_dir);
+  }
+};
+
+} // namespace
+
+TEST_CASE("A cached status is found until it expires")
+{
+  LocalityCache cache{100, 100ms};
+  PhysicalPath const path{"/tmp/foo"};
+
+  CHECK_FALSE(cache.find(path).has_value());
+  cache.insert(path, make_status(42));
+  auto const status = cache.find(path);
+  REQUIRE(status.has_value());
+  CHECK_EQ(status->size, 42);
+  CHECK(status->on_tape);
+
+  std::this_thread::sleep_for(150ms);
+  CHECK_FALSE(cache.find(path).has_value());
+
+  auto const stats = cache.stats();
+  CHECK_EQ(stats.hits, 1);
+  CHECK_EQ(stats.misses, 2);
+  CHECK_EQ(stats.expirations, 1);
+  CHECK_EQ(stats.size, 0);
+}
+
+TEST_CASE("The cache is bounded")
+{
+  LocalityCache cache{16, 1h};
+  for (std::size_t i = 0; i != 1000; ++i) {
+    cache.insert(PhysicalPath{fmt::format("/tmp/file{}", i)}, make_status(i));
+  }
+  auto const stats = cache.stats();
+  CHECK_LE(stats.size, 16);
+  CHECK_EQ(stats.size + stats.evictions, 1000);
+}
+
+TEST_CASE("An entry can be invalidated")
+{
+  LocalityCache cache{100, 1h};
+  PhysicalPath const path{"/tmp/foo"};
+  cache.insert(path, make_status(42));
+  cache.invalidate(path);
+  CHECK_FALSE(cache.find(path).has_value());
+  CHECK_EQ(cache.stats().invalidations, 1);
+}
+
+TEST_CASE("A cache with no capacity or no time-to-live stores nothing")
+{
+  PhysicalPath const path{"/tmp/foo"};
+  for (auto [capacity, ttl] :
+       {std::pair{std::size_t{0}, LocalityCache::Clock::duration{1h}},
+        std::pair{std::size_t{100}, LocalityCache::Clock::duration{0}}}) {
+    LocalityCache cache{capacity, ttl};
+    cache.insert(path, make_status(42));
+    CHECK_FALSE(cache.find(path).has_value());
+    CHECK_EQ(cache.stats().size, 0);
+  }
+}
+
+TEST_CASE_FIXTURE(CacheFixture, "The caching storage queries only the misses")
+{
+  CountingStorage local;
+  LocalityCache cache{100, 1h};
+  CachingStorage storage{local, cache, false};
+
+  auto const first = storage.file_statuses(std::span{m_paths}.first(1));
+  CHECK_EQ(local.n_queried, 1);
+  auto const second = storage.file_statuses(m_paths);
+  CHECK_EQ(local.n_queried, 2);
+  CHECK_EQ(second.sizes[0], first.sizes[0]);
+  CHECK_EQ(second.sizes[1], 7);
+
+  // errors are not cached
+  PhysicalPaths const missing{PhysicalPath{m_dir / "missing"}};
+  CHECK(storage.file_statuses(missing).errors[0]);
+  CHECK(storage.file_statuses(missing).errors[0]);
+  CHECK_EQ(local.n_queried, 4);
+}
+
+TEST_CASE_FIXTURE(CacheFixture,
+                  "Marking a file in progress invalidates its cached status")
+{
+  CountingStorage local;
+  LocalityCache cache{100, 1h};
+  CachingStorage storage{local, cache, false};
+
+  CHECK_FALSE(storage.file_statuses(m_paths).in_progress[0]);
+  REQUIRE(storage.set_in_progress(m_paths[0]).has_value());
+  auto const statuses = storage.file_statuses(m_paths);
+  CHECK(statuses.in_progress[0]);
+  CHECK_FALSE(statuses.in_progress[1]);
+  CHECK_EQ(local.n_queried, 3);
+}
+
+TEST_CASE_FIXTURE(CacheFixture,
+                  "A change reported by inotify invalidates the cached status")
+{
+  CountingStorage local;
+  LocalityCache cache{100, 1h};
+  CachingStorage storage{local, cache, true};
+
+  CHECK_FALSE(storage.file_statuses(m_paths).on_tape[0]);
+  // changed behind the back of the storage
+  set_xattr(m_paths[0], XAttrName{"user.storm.migrated"}, XAttrValue{""});
+
+  bool on_tape{false};
+  for (int i = 0; i != 100 && !on_tape; ++i) {
+    std::this_thread::sleep_for(10ms);
+    on_tape = storage.file_statuses(m_paths).on_tape[0];
+  }
+  CHECK(on_tape);
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
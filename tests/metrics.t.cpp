@@ -0,0 +1,100 @@
+#include <doctest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.hpp"
+
+namespace storm {
+
+TEST_SUITE_BEGIN("Metrics");
+
+using namespace std::chrono_literals;
+
+// the registry is process-wide, hence the checks are on the differences
+TEST_CASE("The latencies are recorded in the right bucket")
+{
+  auto& metrics     = Metrics::instance();
+  auto const before = metrics.histogram(Operation::release);
+
+  metrics.record(Operation::release, 50us);
+  metrics.record(Operation::release, 100us);
+  metrics.record(Operation::release, 101us);
+  metrics.record(Operation::release, 3s);
+  metrics.record(Operation::release, 1min);
+
+  auto const after = metrics.histogram(Operation::release);
+  auto const delta = [&](std::size_t b) {
+    return after.counts[b] - before.counts[b];
+  };
+  CHECK_EQ(delta(0), 2);
+  CHECK_EQ(delta(1), 1);
+  CHECK_EQ(delta(14), 1);
+  CHECK_EQ(delta(Metrics::n_buckets - 1), 1);
+  CHECK_EQ(after.count() - before.count(), 5);
+  CHECK_EQ(after.sum_ns - before.sum_ns, 63'000'251'000);
+}
+
+TEST_CASE("The latencies recorded by many threads are summed up")
+{
+  auto& metrics     = Metrics::instance();
+  auto const before = metrics.histogram(Operation::cancel).count();
+
+  constexpr int n_threads = 8;
+  constexpr int n_records = 1'000;
+  for (int round = 0; round != 2; ++round) {
+    // the slots of the threads of the first round are reused by the second
+    std::vector<std::jthread> threads;
+    for (int i = 0; i != n_threads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j != n_records; ++j) {
+          metrics.record(Operation::cancel, 1ms);
+        }
+      });
+    }
+  }
+
+  CHECK_EQ(metrics.histogram(Operation::cancel).count() - before,
+           2 * n_threads * n_records);
+}
+
+TEST_CASE("A timer records the time spent in its scope")
+{
+  auto& metrics     = Metrics::instance();
+  auto const before = metrics.histogram(Operation::ready_take_over);
+  {
+    LatencyTimer const timer{Operation::ready_take_over};
+    std::this_thread::sleep_for(2ms);
+  }
+  auto const after = metrics.histogram(Operation::ready_take_over);
+  CHECK_EQ(after.count() - before.count(), 1);
+  CHECK_GE(after.sum_ns - before.sum_ns, 2'000'000);
+}
+
+TEST_CASE("The histograms are exported in the Prometheus format")
+{
+  auto& metrics = Metrics::instance();
+  metrics.record(Operation::db_find, 7ms);
+  auto const h    = metrics.histogram(Operation::db_find);
+  auto const text = metrics.to_prometheus();
+  auto const contains = [&](std::string const& s) {
+    return text.find(s) != std::string::npos;
+  };
+
+  CHECK(contains("# TYPE storm_tape_request_duration_seconds histogram\n"));
+  CHECK(contains("# TYPE storm_tape_database_duration_seconds histogram\n"));
+  CHECK(contains("# TYPE storm_tape_storage_duration_seconds histogram\n"));
+  CHECK(contains("storm_tape_request_duration_seconds_bucket"
+                 "{operation=\"STAGE\",le=\"0.0001\"} "));
+  CHECK(contains("storm_tape_database_duration_seconds_bucket"
+                 "{method=\"find\",le=\"+Inf\"} "
+                 + std::to_string(h.count()) + "\n"));
+  CHECK(contains("storm_tape_database_duration_seconds_count"
+                 "{method=\"find\"} "
+                 + std::to_string(h.count()) + "\n"));
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
@@ -0,0 +1,56 @@
+#include <doctest.h>
+
+#include "path_table.hpp"
+
+namespace storm {
+
+TEST_SUITE_BEGIN("PathTable");
+
+TEST_CASE("The paths stored in a PathTable are retrieved by index")
+{
+  PathTable table;
+  auto const a = table.add("/atlas/a/file1", "/storage/atlas/a/file1");
+  auto const b = table.add("/atlas/b/file2", "/storage/atlas/b/file2");
+  auto const c = table.add("/tmp/file3", "/tmp/file3");
+  auto const d = table.add("/cms/x1", "/gpfs/y1");
+
+  REQUIRE_EQ(table.size(), 4);
+
+  CHECK_EQ(table.physical(a), "/storage/atlas/a/file1");
+  CHECK_EQ(table.logical(a).str(), "/atlas/a/file1");
+  CHECK_EQ(table.physical(b), "/storage/atlas/b/file2");
+  CHECK_EQ(table.logical(b).str(), "/atlas/b/file2");
+  CHECK_EQ(table.physical(c), "/tmp/file3");
+  CHECK_EQ(table.logical(c).str(), "/tmp/file3");
+  CHECK_EQ(table.physical(d), "/gpfs/y1");
+  CHECK_EQ(table.logical(d).str(), "/cms/x1");
+}
+
+TEST_CASE("The files of the same storage area share the logical prefix")
+{
+  PathTable table;
+  auto const a = table.add("/atlas/a/file1", "/storage/data/a/file1");
+  auto const b = table.add("/atlas/b/file2", "/storage/data/b/file2");
+
+  CHECK_EQ(table.logical(a).prefix, "/atlas");
+  CHECK_EQ(table.logical(a).prefix.data(), table.logical(b).prefix.data());
+  CHECK_EQ(table.logical(a).tail, "/a/file1");
+  CHECK_EQ(table.logical(b).tail, "/b/file2");
+}
+
+TEST_CASE("Split paths are compared as whole strings")
+{
+  PathParts const parts{"/atlas", "/a/file1"};
+
+  CHECK_EQ(compare(parts, "/atlas/a/file1"), 0);
+  CHECK_LT(compare(parts, "/atlas/b"), 0);
+  CHECK_GT(compare(parts, "/atlas/a"), 0);
+  CHECK_GT(compare(parts, "/at"), 0);
+  CHECK_LT(compare(parts, "/b"), 0);
+  CHECK_GT(compare(parts, "/a"), 0);
+  CHECK_LT(compare(PathParts{"", "/atlas"}, "/atlas/a"), 0);
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
@@ -0,0 +1,64 @@
+#include <doctest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace storm {
+
+TEST_SUITE_BEGIN("Profiler");
+
+TEST_CASE("A full profile buffer drops the results and counts them")
+{
+  auto const buffer = std::make_unique<ProfileBuffer>();
+  auto const n      = ProfileBuffer::capacity + 10;
+  std::size_t n_pushed{0};
+  for (std::size_t i = 0; i != n; ++i) {
+    auto const t = static_cast<long long>(i);
+    n_pushed += buffer->push({"scope", t, t + 1, 0});
+  }
+  CHECK_EQ(n_pushed, ProfileBuffer::capacity);
+  CHECK_EQ(buffer->take_dropped(), 10);
+  CHECK_EQ(buffer->take_dropped(), 0);
+
+  std::vector<ProfileResult> results;
+  CHECK_EQ(buffer->drain(results), ProfileBuffer::capacity);
+  REQUIRE_EQ(results.size(), ProfileBuffer::capacity);
+  CHECK_EQ(results.front().start, 0);
+  CHECK_EQ(results.back().start, ProfileBuffer::capacity - 1);
+
+  // there is room again
+  CHECK(buffer->push({"scope", 0, 1, 0}));
+  CHECK_EQ(buffer->drain(results), 1);
+}
+
+TEST_CASE("The results are drained in order while being pushed")
+{
+  auto const buffer = std::make_unique<ProfileBuffer>();
+  constexpr long long n{100'000};
+
+  std::jthread producer{[&] {
+    for (long long i = 0; i != n;) {
+      if (buffer->push({"scope", i, i, 0})) {
+        ++i;
+      }
+    }
+  }};
+
+  std::vector<ProfileResult> results;
+  while (results.size() != n) {
+    buffer->drain(results);
+  }
+  producer.join();
+
+  bool in_order = true;
+  for (std::size_t i = 0; i != results.size(); ++i) {
+    in_order = in_order && results[i].start == static_cast<long long>(i);
+  }
+  CHECK(in_order);
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
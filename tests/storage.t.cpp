@@ -0,0 +1,179 @@
+#include <doctest.h>
+#include <fmt/core.h>
+#include <filesystem>
+#include <fstream>
+
+#include "extended_attributes.hpp"
+#include "local_storage.hpp"
+#include "storage.hpp"
+#ifdef STORM_IO_URING
+#include "uring_prober.hpp"
+#endif
+
+namespace storm {
+
+TEST_SUITE_BEGIN("Storage");
+
+namespace {
+
+// forward the single-file queries to LocalStorage, but use the default
+// implementation of the batch query
+struct PerFileStorage : Storage
+{
+  LocalStorage m_storage;
+  Result<bool> is_in_progress(PhysicalPath const& path) override
+  {
+    return m_storage.is_in_progress(path);
+  }
+  Result<FileSizeInfo> file_size_info(PhysicalPath const& path) override
+  {
+    return m_storage.file_size_info(path);
+  }
+  Result<bool> is_on_tape(PhysicalPath const& path) override
+  {
+    return m_storage.is_on_tape(path);
+  }
+  Result<void> set_in_progress(PhysicalPath const& path) override
+  {
+    return m_storage.set_in_progress(path);
+  }
+};
+
+class StorageFixture
+{
+ protected:
+  fs::path m_dir{"/tmp/storage-test"};
+  PhysicalPaths m_paths;
+
+ public:
+  StorageFixture()
+  {
+    fs::create_directories(m_dir / "dir");
+    auto const add = [&](char const* name, char const* content) {
+      auto const path = m_dir / name;
+      std::ofstream{path} << content;
+      m_paths.emplace_back(path);
+      return path;
+    };
+    add("plain", "plain");
+    set_xattr(add("on_tape", "on tape"), XAttrName{"user.storm.migrated"},
+              XAttrValue{""});
+    auto const both = add("both", "both");
+    set_xattr(both, XAttrName{"user.storm.migrated"}, XAttrValue{""});
+    set_xattr(both, XAttrName{"user.TSMRecT"}, XAttrValue{""});
+    auto const many = add("many", "many xattrs");
+    // more names than fit in the initial listxattr buffer
+    for (int i = 0; i != 100; ++i) {
+      set_xattr(many, XAttrName{fmt::format("user.some.long.name.{:04}", i)},
+                XAttrValue{""});
+    }
+    set_xattr(many, XAttrName{"user.TSMRecT"}, XAttrValue{""});
+    add("empty", "");
+    m_paths.emplace_back(m_dir / "dir");
+    m_paths.emplace_back(m_dir / "missing");
+    m_paths.emplace_back(m_dir / "plain" / "not_a_dir");
+  }
+  ~StorageFixture()
+  {
+    fs::remove_all(m_dir);
+  }
+};
+
+} // namespace
+
+TEST_CASE_FIXTURE(StorageFixture,
+                  "The batch query is equivalent to the single-file queries")
+{
+  LocalStorage local;
+  PerFileStorage per_file;
+  auto const batch     = local.file_statuses(m_paths);
+  auto const reference = per_file.file_statuses(m_paths);
+
+  REQUIRE_EQ(batch.size(), m_paths.size());
+  REQUIRE_EQ(reference.size(), m_paths.size());
+  for (std::size_t i = 0; i != m_paths.size(); ++i) {
+    CAPTURE(m_paths[i]);
+    CHECK_EQ(static_cast<bool>(batch.errors[i]),
+             static_cast<bool>(reference.errors[i]));
+    if (batch.errors[i]) {
+      continue;
+    }
+    CHECK_EQ(batch.types[i], reference.types[i]);
+    CHECK_EQ(batch.sizes[i], reference.sizes[i]);
+    CHECK_EQ(batch.is_stub[i], reference.is_stub[i]);
+    CHECK_EQ(batch.in_progress[i], reference.in_progress[i]);
+    CHECK_EQ(batch.on_tape[i], reference.on_tape[i]);
+  }
+
+  // plain, on_tape, both, many, empty, dir, missing, not_a_dir
+  CHECK_FALSE(batch.on_tape[0]);
+  CHECK_FALSE(batch.in_progress[0]);
+  CHECK(batch.on_tape[1]);
+  CHECK_FALSE(batch.in_progress[1]);
+  CHECK(batch.on_tape[2]);
+  CHECK(batch.in_progress[2]);
+  CHECK_FALSE(batch.on_tape[3]);
+  CHECK(batch.in_progress[3]);
+  CHECK_EQ(batch.sizes[4], 0);
+  CHECK_EQ(batch.types[5], fs::file_type::directory);
+  CHECK_EQ(batch.errors[6], std::errc::no_such_file_or_directory);
+  CHECK_EQ(batch.errors[7], std::errc::not_a_directory);
+}
+
+#ifdef STORM_IO_URING
+
+TEST_CASE_FIXTURE(StorageFixture,
+                  "The io_uring prober agrees with the synchronous calls")
+{
+  UringProber prober{8};
+  // more files than fit in a window of requests
+  PhysicalPaths paths;
+  for (int i = 0; i != 10; ++i) {
+    paths.insert(paths.end(), m_paths.begin(), m_paths.end());
+  }
+
+  FileStatuses probed(paths.size());
+  prober.probe(paths, probed);
+  PerFileStorage per_file;
+  auto const reference = per_file.file_statuses(paths);
+
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    CAPTURE(paths[i]);
+    CHECK_EQ(probed.errors[i], reference.errors[i]);
+    if (probed.errors[i]) {
+      continue;
+    }
+    CHECK_EQ(probed.types[i], reference.types[i]);
+    CHECK_EQ(probed.sizes[i], reference.sizes[i]);
+    CHECK_EQ(probed.is_stub[i], reference.is_stub[i]);
+    if (prober.has_getxattr()) {
+      CHECK_EQ(probed.in_progress[i], reference.in_progress[i]);
+      CHECK_EQ(probed.on_tape[i], reference.on_tape[i]);
+    }
+  }
+}
+
+#endif
+
+TEST_CASE("The status of a chunk can be copied into a larger result")
+{
+  FileStatuses all(4);
+  FileStatuses part(2);
+  part.errors[1]      = std::make_error_code(std::errc::permission_denied);
+  part.sizes[0]       = 42;
+  part.on_tape[0]     = true;
+  part.types[0]       = fs::file_type::regular;
+  part.in_progress[1] = true;
+
+  all.assign(2, part);
+  CHECK_FALSE(all.errors[0]);
+  CHECK_EQ(all.sizes[2], 42);
+  CHECK(all.on_tape[2]);
+  CHECK_EQ(all.types[2], fs::file_type::regular);
+  CHECK_EQ(all.errors[3], std::errc::permission_denied);
+  CHECK(all.in_progress[3]);
+}
+
+TEST_SUITE_END;
+
+} // namespace storm
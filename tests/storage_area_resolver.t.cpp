@@ -119,4 +119,46 @@ TEST_CASE("Resolve a storage area with multiple nested access points")
   }
 }
 
+TEST_CASE("Resolve paths that match an access point only partially")
+{
+  storm::StorageAreas const sas{
+    {"atlas", "/storage/atlas/", {"/atlas/data", "/atlasdisk"}},
+    {"alice", "/storage/alice" , {"/"}}
+  };
+  storm::StorageAreaResolver resolve{sas};
+
+  CHECK(resolve("/atlas/data/")          == "/storage/atlas/");
+  CHECK(resolve("/atlas/data/dir/")      == "/storage/atlas/dir/");
+  CHECK(resolve("/atlas/data/dir/file")  == "/storage/atlas/dir/file");
+  CHECK(resolve("/atlas/datafile")       == "/storage/alice/atlas/datafile");
+  CHECK(resolve("/atlas")                == "/storage/alice/atlas");
+  CHECK(resolve("/atlasdisk/file")       == "/storage/atlas/file");
+  CHECK(resolve("/")                     == "/storage/alice");
+}
+
+TEST_CASE("Resolve many paths at once")
+{
+  storm::StorageAreas const sas{
+    {"atlas", "/storage/atlas", {"/atlas"}},
+    {"cms"  , "/storage/cms"  , {"/cms", "/cms/data"}}
+  };
+  storm::StorageAreaResolver resolve{sas};
+
+  storm::LogicalPaths const paths{
+    "/cms/data/file2", "/atlas/dir/file1", "/cms/file", "/atlas/dir/file2",
+    "/cms/data/file1", "/other/file", "/atlas/dir/../file", "/atlas//dir/file3"
+  };
+  storm::PhysicalPaths out(paths.size());
+  resolve(paths, out);
+
+  for (std::size_t i = 0; i != paths.size(); ++i) {
+    CHECK(out[i] == resolve(paths[i]));
+  }
+  CHECK(out[0] == "/storage/cms/file2");
+  CHECK(out[1] == "/storage/atlas/dir/file1");
+  CHECK(out[5] == "");
+  CHECK(out[6] == "");
+  CHECK(out[7] == "/storage/atlas/dir/file3");
+}
+
 TEST_SUITE_END;
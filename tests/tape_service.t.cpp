@@ -1,8 +1,10 @@
 #include <doctest.h>
 #include <fmt/core.h>
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <system_error>
 #include <thread>
 
 #include "cancel_response.hpp"
@@ -11,6 +13,8 @@
 #include "fixture.t.hpp"
 #include "in_progress_request.hpp"
 #include "in_progress_response.hpp"
+#include "readytakeover_response.hpp"
+#include "reconciler.hpp"
 #include "requests_with_paths.hpp"
 #include "stage_request.hpp"
 #include "stage_response.hpp"
@@ -56,6 +60,7 @@ TEST_CASE_FIXTURE(TestFixture, "Stage")
   auto id             = stage_response.id();
 
   {
+    m_service.reconcile();
     auto status_response = m_service.status(id);
     auto& stage          = status_response.stage();
     auto& files          = stage.files;
@@ -68,6 +73,7 @@ TEST_CASE_FIXTURE(TestFixture, "Stage")
     fs::remove(FILES[0].physical_path);
     fs::remove(FILES[1].physical_path);
 
+    m_service.reconcile();
     auto status_response = m_service.status(id);
     auto& stage          = status_response.stage();
     auto& files          = stage.files;
@@ -125,6 +131,7 @@ TEST_CASE_FIXTURE(TestFixture, "In Progress")
       CHECK_EQ(resp.paths.size(), 1);
     }
 
+    m_service.reconcile();
     auto status_response = m_service.status(id);
     auto& files          = status_response.stage().files;
 
@@ -187,6 +194,7 @@ TEST_CASE_FIXTURE(TestFixture, "Stage")
   // Do status
   {
     // check from response
+    m_service.reconcile();
     auto status_response = m_service.status(id);
     auto& stage          = status_response.stage();
     auto& files          = stage.files;
@@ -247,6 +255,7 @@ TEST_CASE_FIXTURE(TestFixture, "Stage")
   // Do status again
   {
     // check from response
+    m_service.reconcile();
     auto const status = m_service.status(id);
     auto& stage       = status.stage();
     auto& files       = stage.files;
@@ -289,6 +298,7 @@ TEST_CASE_FIXTURE(TestFixture, "Stage")
   // Do status for the last time, now everything should be finished
   {
     // check from response
+    m_service.reconcile();
     auto const status = m_service.status(id);
     auto& stage       = status.stage();
     auto& files       = stage.files;
@@ -351,6 +361,7 @@ TEST_CASE_FIXTURE(TestFixture, "Cancel")
                  [](File const& f) { return LogicalPath{f.logical_path}; });
   m_service.cancel(id, CancelRequest{paths});
   // Do status
+  m_service.reconcile();
   auto stage = m_service.status(id).stage();
   CHECK_EQ(stage.created_at, now);
   CHECK_GT(stage.started_at, now);
@@ -359,6 +370,149 @@ TEST_CASE_FIXTURE(TestFixture, "Cancel")
               [](auto& f) { return f.state == File::State::cancelled; }));
 }
 
+TEST_CASE_FIXTURE(TestFixture, "Concurrent stages")
+{
+  make_file(FILES[0].physical_path);
+  make_file(FILES[1].physical_path);
+
+  constexpr int n_threads = 4;
+  std::vector<StageId> ids(n_threads);
+  {
+    std::vector<std::jthread> threads;
+    for (int i = 0; i != n_threads; ++i) {
+      threads.emplace_back([&, i] {
+        StageRequest request{FILES, now, 0, 0};
+        ids[static_cast<std::size_t>(i)] =
+            m_service.stage(std::move(request)).id();
+      });
+    }
+  }
+
+  std::sort(ids.begin(), ids.end());
+  CHECK(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+  for (auto const& id : ids) {
+    REQUIRE_FALSE(id.empty());
+    auto const status = m_service.status(id);
+    CHECK_EQ(status.stage().files.size(), FILES.size());
+  }
+
+  for (auto& f : FILES) {
+    delete_file(f.physical_path);
+  }
+}
+
+TEST_CASE_FIXTURE(TestFixture, "Status does not probe the storage")
+{
+  make_file(FILES[0].physical_path);
+  make_file(FILES[1].physical_path);
+
+  auto const id = m_service.stage(StageRequest{FILES, now, 0, 0}).id();
+  REQUIRE_FALSE(id.empty());
+
+  {
+    auto const status = m_service.status(id);
+    auto& files       = status.stage().files;
+    CHECK(std::all_of(files.begin(), files.end(), [](auto const& f) {
+      return f.state == File::State::submitted;
+    }));
+    CHECK_EQ(status.stage().completed_at, 0);
+  }
+
+  m_service.reconcile();
+
+  {
+    auto const status = m_service.status(id);
+    auto& files       = status.stage().files;
+    CHECK(std::all_of(files.begin(), files.end(), [](auto const& f) {
+      return f.state == File::State::completed;
+    }));
+    CHECK_GT(status.stage().completed_at, 0);
+  }
+
+  for (auto& f : FILES) {
+    delete_file(f.physical_path);
+  }
+}
+
+TEST_CASE_FIXTURE(TestFixture,
+                  "The reconciler updates the stages in the background")
+{
+  make_file(FILES[0].physical_path);
+  make_file(FILES[1].physical_path);
+
+  auto const id = m_service.stage(StageRequest{FILES, now, 0, 0}).id();
+  REQUIRE_FALSE(id.empty());
+
+  {
+    // the first pass starts immediately, the next ones are far away
+    Reconciler reconciler{m_service, std::chrono::hours{1}};
+    using namespace std::chrono_literals;
+    auto const deadline = std::chrono::steady_clock::now() + 10s;
+    while (m_service.status(id).stage().completed_at == 0
+           && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+
+  CHECK_GT(m_service.status(id).stage().completed_at, 0);
+
+  for (auto& f : FILES) {
+    delete_file(f.physical_path);
+  }
+}
+
+namespace {
+
+// refuse to mark the second file as in progress
+struct PickyStorage : LocalStorage
+{
+  Result<void> set_in_progress(PhysicalPath const& path) override
+  {
+    if (path == FILES[1].physical_path) {
+      return std::make_error_code(std::errc::permission_denied);
+    }
+    return LocalStorage::set_in_progress(path);
+  }
+};
+
+using PickyFixture = BasicTestFixture<PickyStorage>;
+
+} // namespace
+
+TEST_CASE_FIXTURE(PickyFixture,
+                  "A file that cannot be marked as in progress stays submitted")
+{
+  make_stub(FILES[0].physical_path);
+  make_stub(FILES[1].physical_path);
+
+  auto const id = m_service.stage(StageRequest{FILES, now, 0, 0}).id();
+  REQUIRE_FALSE(id.empty());
+
+  // only the marked file is passed to GEMSS and started
+  auto const to_resp = m_service.take_over({.n_files = 10});
+  REQUIRE_EQ(to_resp.paths.size(), 1);
+  CHECK_EQ(to_resp.paths[0], FILES[0].physical_path);
+  CHECK(has_xattr(FILES[0].physical_path, XAttrName{"user.TSMRecT"}));
+  CHECK_FALSE(has_xattr(FILES[1].physical_path, XAttrName{"user.TSMRecT"}));
+
+  auto const resp = m_service.in_progress({.precise = 0});
+  REQUIRE_EQ(resp.paths.size(), 1);
+  CHECK_EQ(resp.paths[0], FILES[0].physical_path);
+  CHECK_EQ(m_service.in_progress().paths, resp.paths);
+  CHECK_EQ(m_service.ready_take_over().n_ready, 1);
+
+  auto const status = m_service.status(id);
+  for (auto const& f : status.stage().files) {
+    CHECK_EQ(f.state, f.physical_path == FILES[0].physical_path
+                          ? File::State::started
+                          : File::State::submitted);
+  }
+
+  for (auto& f : FILES) {
+    delete_file(f.physical_path);
+  }
+}
+
 TEST_CASE("Loading config without a port must set the port to default 8080")
 {
   auto constexpr conf = R"(